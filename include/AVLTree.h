@@ -1,23 +1,27 @@
 #ifndef AVLTREE_H
 #define AVLTREE_H
 
+#include <cstdint>
 #include <iostream>
 #include <string>
 
 #include <vector>
 #include <array>
 
+#include "Memtable.h"
+
 using namespace std;
 
 /**
- * Represents a node in the AVL tree.
+ * Represents a node in the AVL tree. Children are referenced by their index in
+ * the tree's node arena rather than by pointer, which keeps a node at 20 bytes.
  */
 class Node {
 public:
     int key;
     int value;
-    Node *left;
-    Node *right;
+    uint32_t left;
+    uint32_t right;
     int height;
 
     Node(int key, int value);
@@ -25,10 +29,19 @@ public:
 
 /**
  * An AVL tree representing the memtable of the KV store.
+ *
+ * All nodes live in a single arena that is reserved up front from the capacity
+ * of the tree, so inserting never calls malloc and clearing the tree releases
+ * every node at once.
  */
-class AVLTree {
+class AVLTree : public Memtable {
 public:
-    Node *root;
+    /**
+     * The index representing the absence of a node
+     */
+    static constexpr uint32_t NIL = UINT32_MAX;
+
+    uint32_t root;
     int capacity;
     int size;
 
@@ -38,34 +51,93 @@ public:
      * Insert the KV-Pair and returns whether the tree is full
      * @return 0 if successfully inserted, 1 if the tree is full
      */
-    bool insert(int key, int value);
+    bool insert(int key, int value) override;
+
+    /**
+     * Insert the KV-Pair unless the tree is already full
+     * @return whether the KV-Pair was inserted
+     */
+    bool tryInsert(int key, int value) override;
+
+    /**
+     * Returns whether the tree has reached its capacity
+     */
+    bool isFull() override;
 
     /**
      * Returns the value of the key. Throws exception when the key is not found.
      */
-    int getValue(int key);
+    int getValue(int key) override;
+
+    /**
+     * Returns the value of the key, or nothing when the key is not found
+     */
+    optional<int> tryGet(int key) override;
+
+    /**
+     * An in-order iterator over the tree which keeps the path to the current
+     * node on an explicit stack
+     */
+    class Iterator : public KVIterator {
+    private:
+        const AVLTree &myTree;
+
+        /**
+         * The nodes whose key is not yet visited, with the current node on top
+         */
+        vector<uint32_t> myStack;
+
+        /**
+         * push the given node and all its left descendants onto the stack
+         */
+        void pushLeftPath(uint32_t node);
+
+    public:
+        explicit Iterator(const AVLTree &theTree);
+
+        void seekToFirst() override;
+
+        void seek(int theTarget) override;
+
+        bool valid() override;
+
+        void next() override;
+
+        int key() override;
+
+        int value() override;
+    };
 
     /**
      * Scan the memtable and retrieves all KV-Pairs in a key range in key order (low < high)
-     * @param node the root node of the subtree that will be searched
      * @return a vector of KV-pairs
      */
-    vector<array<int, 2>> scan(Node *node, int low, int high);
+    vector<array<int, 2>> scan(int low, int high) override;
+
+    /**
+     * An overload of scan which scans all the nodes of the tree.
+     */
+    vector<array<int, 2>> scan() override;
 
     /**
-     * An overload of scan which defaults to the root node of the AVL tree.
+     * Returns an in-order iterator over the tree
      */
-    vector<array<int, 2>> scan(int low, int high);
+    unique_ptr<KVIterator> newIterator() override;
 
     /**
-     * An overload of scan which defaults scan all the nodes of the tree.
+     * Build a perfectly balanced tree from the sorted KV-Pairs
      */
-    vector<array<int, 2>> scan(Node *node);
+    void bulkLoad(const array<int, 2> *kvPairs, size_t count) override;
 
     /**
-     * An overload of scan which defaults to the root node of the AVL tree and scan all the nodes.
+     * Remove every KV-Pair from the tree in O(1), keeping the arena for reuse
      */
-    vector<array<int, 2>> scan();
+    void clear() override;
+
+    /**
+     * The AVL tree only supports a single writer
+     */
+    bool isConcurrent() override;
 
     /**
      * Returns a in-order string representation of the tree
@@ -77,49 +149,57 @@ public:
      */
     string preOrderString();
 
-    // Destructor
-    ~AVLTree();
-
 private:
+    /**
+     * The arena holding every node of the tree, reserved to the capacity
+     */
+    vector<Node> nodes;
+
+    /**
+     * allocate a node from the arena and return its index
+     */
+    uint32_t allocateNode(int key, int val);
+
     /**
      * get the height of the subtree from the given node
      */
-    static int getHeight(Node *node);
+    int getHeight(uint32_t node);
 
     /**
      * get the balance of the subtree from the given node
      */
-    static int getBalance(Node *node);
+    int getBalance(uint32_t node);
 
     /**
      * insert a KV-Pair into the subtree from the subtree of the given node
      */
-    Node *insertNode(Node *node, int key, int val);
+    uint32_t insertNode(uint32_t node, int key, int val);
 
     /**
-     * get node with the given key from the subtree of the given node
+     * build a balanced subtree from the sorted KV-Pairs in [begin, end)
+     * @return the root of the subtree
      */
-    int getValueNode(Node *node, int key);
+    uint32_t buildBalanced(const array<int, 2> *kvPairs, size_t begin, size_t end);
 
     /**
-     * perform a right rotation on the subtree of the given node
+     * get the value of the given key from the subtree of the given node
      */
-    static Node *rightRotate(Node *node);
+    optional<int> tryGetNode(uint32_t node, int key);
 
     /**
-     * perform a left rotation on the subtree of the given node
+     * perform a right rotation on the subtree of the given node
      */
-    static Node *leftRotate(Node *node);
+    uint32_t rightRotate(uint32_t node);
 
     /**
-     * a helper for the pre-order string representation of the tree
+     * perform a left rotation on the subtree of the given node
      */
-    string preOrderNodeString(Node *node);
+    uint32_t leftRotate(uint32_t node);
 
     /**
-     * delete the tree and free all memories
+     * a helper for the pre-order string representation of the tree
      */
-    void deleteTree(Node *node);
+    string preOrderNodeString(uint32_t node);
 };
 
 #endif
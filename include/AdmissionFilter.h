@@ -0,0 +1,71 @@
+#ifndef ADMISSIONFILTER_H
+#define ADMISSIONFILTER_H
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "PageId.h"
+
+using namespace std;
+
+/**
+ * The policy deciding whether a page read from storage may replace the
+ * victim picked by the eviction policy
+ */
+enum class AdmissionPolicyType {
+    // every page is cached
+    NONE,
+    // a page is cached only if it is read more often than the victim
+    TINY_LFU
+};
+
+/**
+ * Decides which pages enter a shard of the buffer pool. Every method is
+ * called with the lock of the shard held.
+ */
+class AdmissionFilter {
+   public:
+    virtual ~AdmissionFilter() = default;
+
+    // A page was looked up in the pool, whether it was found or not
+    virtual void recordAccess(PageId pageId) = 0;
+
+    // Returns whether the candidate page should replace the victim page
+    virtual bool admit(PageId candidate, PageId victim) = 0;
+
+    // Returns nullptr for NONE, as every page is admitted
+    static unique_ptr<AdmissionFilter> create(AdmissionPolicyType type, int sketchWidth);
+};
+
+/**
+ * TinyLFU: estimates how often pages are read with a count-min sketch, and
+ * admits a page only if it is more frequent than the victim. The counters
+ * are halved after every 10 * sketchWidth accesses, so the estimates follow
+ * changes of the workload.
+ */
+class TinyLFUFilter : public AdmissionFilter {
+   private:
+    static constexpr int DEPTH = 4;          // Number of rows of the sketch
+    static constexpr uint8_t MAX_COUNT = 15;  // Counters saturate at 4 bits
+
+    size_t width;  // Counters per row, a power of two
+    vector<uint8_t> counters;  // DEPTH rows of width counters
+    size_t numSamples;  // Accesses recorded since the last halving
+    size_t sampleSize;  // Accesses between two halvings
+
+    // Returns the index of the counter of the page in the given row
+    size_t counterIdx(uint64_t hash, int row);
+
+   public:
+    explicit TinyLFUFilter(int sketchWidth);
+
+    // Returns the estimated number of recent accesses of the page
+    int estimate(PageId pageId);
+
+    void recordAccess(PageId pageId) override;
+
+    bool admit(PageId candidate, PageId victim) override;
+};
+
+#endif
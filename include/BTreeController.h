@@ -5,6 +5,7 @@
 #include <fstream>
 #include <iostream>
 #include <memory>
+#include <optional>
 #include <vector>
 
 #include "BufferPool.h"
@@ -55,7 +56,7 @@ class BTreeController {
      * Searches an SST node file for the page number the key is in
      * @return the page number the key might be in within the SST number
      */
-    pair<bool, int> searchBTreeNodes(int key, int sstNum);
+    optional<int> searchBTreeNodes(int key, int sstNum);
 
     // Creates a new B tree file for the specified SST file
     void createBTree(int sstIdx);
@@ -63,8 +64,13 @@ class BTreeController {
     // Returns the page number of the page containing the key
     int binarySearchNodeValues(vector<BTreeNodeValue> nodeValues, int key);
 
-    // Returns the B-tree node stored in the page position
-    BTreeNode readBTreePage(int fd, int page);
+    /**
+     * Returns the B-tree node stored in the page position. The nodes are
+     * cached in the high-priority tier of the buffer pool, and the B-tree
+     * file is only acquired from the table cache, into file, when a node is
+     * missing from it.
+     */
+    BTreeNode readBTreePage(shared_ptr<OpenFile>& file, int sstIdx, int page);
 
     // Returns the path for B-tree nodes file for the SST index
     string getBTreeFileName(int sstIdx);
@@ -88,6 +94,12 @@ class BTreeController {
      * @return the value associated with the key, or -1 if not found
      */
     pair<bool, int> get(int key);
+
+    /**
+     * Search for key in the database using the B-trees of each SST
+     * @return the value associated with the key, or nothing if not found
+     */
+    optional<int> tryGet(int key);
 };
 
 #endif
\ No newline at end of file
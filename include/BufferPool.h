@@ -1,62 +1,433 @@
 #ifndef BUFFERPOOL_H
 #define BUFFERPOOL_H
 
+#include <sys/types.h>
+
 #include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
 #include <iostream>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
+#include "AdmissionFilter.h"
+#include "EvictionPolicy.h"
+#include "KVSpan.h"
+#include "PageId.h"
+#include "PageTable.h"
+
 using namespace std;
 
-struct BufferFrame {
-    BufferFrame* next;  // Next frame in the chaining (linked list)
+/**
+ * The tier of a page in the buffer pool
+ */
+enum class PagePriority : uint8_t {
+    // data pages, which only evict each other
+    NORMAL,
+    // index pages, e.g. B-tree nodes, which are small but read by every
+    // lookup. They may evict data pages until they fill the high-priority
+    // region of the pool, and data pages never evict them.
+    HIGH
+};
 
-    string pageId;                  // {sst num}-{page num}
-    vector<array<int, 2>> kvPairs;  // Page data (4KB) or less
+/**
+ * Reads a page into the given PAGE_SIZE-aligned buffer of PAGE_SIZE bytes
+ * @return the number of bytes read, or 0 or less when there is no page
+ */
+using PageReader = function<ssize_t(char* buffer)>;
+
+struct BufferFrame {
+    PageId pageId;
+    size_t numKVPairs;  // The number of KV-pairs in the page (4KB or less)
+    int pinCount;  // The number of handles using the frame; never evicted while > 0
     bool isDirty;  // Flag to indicate if the page has been modified
-    bool refBit;   // Bit used by clock to mark page access
+    bool isCached;  // Whether the page table maps the page to this frame
+    PagePriority priority;  // The tier of the page, only evicted for pages of its tier or above
+};
 
-    BufferFrame(string pageId, vector<array<int, 2>> kvPairs);
+/**
+ * Memory mapped for frames. A region larger than a huge page is backed by
+ * huge pages when asked, so random lookups over many frames miss the TLB
+ * less: explicit huge pages when the system reserved some, and transparent
+ * ones otherwise. Slices of a region share its mapping.
+ */
+struct FrameMemory {
+    shared_ptr<char> memory;
+    bool isHugePageBacked = false;
+
+    // Maps the given number of bytes, or throws bad_alloc
+    static FrameMemory map(size_t numBytes, bool useHugePages);
+
+    // Returns the memory starting at the given offset, keeping the whole
+    // region mapped
+    FrameMemory slice(size_t offset) const;
 };
 
-class BufferPool {
+/**
+ * A page-aligned block of memory holding consecutive frames. The pool grows
+ * by adding blocks, so resizing never moves a pinned page.
+ */
+struct FrameChunk {
+    int firstFrame;
+    int numFrames;
+    FrameMemory memory;
+};
+
+/**
+ * How a page read from storage is put into the buffer pool
+ */
+enum class CacheHint {
+    NORMAL,
+    // the page is handed out without being cached, e.g. for scans and
+    // compaction reads which would flush the hot pages out of the pool
+    DONT_CACHE
+};
+
+/**
+ * Tunables of a buffer pool
+ */
+struct BufferPoolOptions {
+    // The number of shards, or 0 to pick it from the capacity
+    int numShards = 0;
+
+    // The policy evicting pages from each shard
+    EvictionPolicyType evictionPolicy = EvictionPolicyType::CLOCK;
+
+    // The policy deciding whether a page read from storage is cached
+    AdmissionPolicyType admissionPolicy = AdmissionPolicyType::NONE;
+
+    // The number of counters per row of the TinyLFU sketch over all shards,
+    // or 0 for 8 per frame. Larger sketches estimate rarer pages better.
+    int admissionSketchWidth = 0;
+
+    // The fraction of the frames of each shard which high-priority pages may
+    // take. Data pages use these frames while index pages do not need them.
+    double highPriorityRatio = 0.25;
+
+    // Whether the frame memory is backed by huge pages, falling back to
+    // regular pages when the system has none
+    bool useHugePages = true;
+};
+
+class BufferPoolShard;
+
+/**
+ * A page pinned in the buffer pool. The KV-pairs are read in place from the
+ * frame, which cannot be evicted until the handle is released or destroyed.
+ *
+ * When every frame is pinned the page cannot be cached, and the handle owns
+ * a private copy of it instead. A page read in place from outside the pool,
+ * e.g. from a mapped file, keeps that memory alive instead.
+ */
+class PageHandle {
+private:
+    BufferPoolShard* myShard;  // nullptr when the page is not pinned in a pool
+    int myFrameIdx;
+    KVSpan myKVPairs;
+    vector<array<int, 2>> myOwnedKVPairs;
+    shared_ptr<const void> myOwner;  // Keeps the memory of the KV-pairs alive
+
+    friend class BufferPoolShard;
+
+    PageHandle(BufferPoolShard* theShard, int theFrameIdx, KVSpan theKVPairs);
+
+   public:
+    // An empty handle, holding no page
+    PageHandle();
+
+    // A handle owning a page which is not cached
+    explicit PageHandle(vector<array<int, 2>> theKVPairs);
+
+    // A handle reading the KV-pairs in place from memory kept alive by the
+    // owner, e.g. a mapped file
+    PageHandle(KVSpan theKVPairs, shared_ptr<const void> theOwner);
+
+    PageHandle(PageHandle&& theOther) noexcept;
+
+    PageHandle& operator=(PageHandle&& theOther) noexcept;
+
+    PageHandle(const PageHandle&) = delete;
+
+    PageHandle& operator=(const PageHandle&) = delete;
+
+    ~PageHandle();
+
+    // Unpins the page, leaving the handle empty
+    void release();
+
+    // Returns the KV-pairs of the page
+    KVSpan kvPairs() const { return myKVPairs; }
+
+    size_t size() const { return myKVPairs.size(); }
+
+    bool empty() const { return myKVPairs.empty(); }
+
+    const array<int, 2>& operator[](size_t theIdx) const { return myKVPairs[theIdx]; }
+
+    const array<int, 2>& back() const { return myKVPairs.back(); }
+
+    const array<int, 2>* begin() const { return myKVPairs.begin(); }
+
+    const array<int, 2>* end() const { return myKVPairs.end(); }
+};
+
+/**
+ * A snapshot of the counters of a buffer pool, or of one of its shards
+ */
+struct BufferPoolStats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;
+    uint64_t rejections = 0;  // Pages kept out of the pool by the admission filter
+    uint64_t probes = 0;      // Page table slots compared by the lookups
+    uint64_t sweepSteps = 0;  // Frames examined by the eviction policy
+
+    // Returns the fraction of the lookups which found their page
+    double hitRate() const;
+
+    // Returns the average length of the probe chains of the lookups
+    double averageProbeLength() const;
+
+    // Returns the average number of frames examined per eviction
+    double averageSweepLength() const;
+
+    BufferPoolStats& operator+=(const BufferPoolStats& other);
+};
+
+/**
+ * The hit and miss counters of the pages of one SST
+ */
+struct SSTCacheStats {
+    int level;
+    int sstIdx;
+    uint64_t hits;
+    uint64_t misses;
+};
+
+/**
+ * An independent part of the buffer pool, with its own frames, page table,
+ * clock and lock
+ */
+class BufferPoolShard {
    private:
-    int capacity;  // Number of buffer frames
+    mutex shardMutex;  // Guards every member below and the pin counts
+    int capacity;  // Number of buffer frames which may hold pages
     int numPages;  // Number of pages in the buffer pool
-    vector<BufferFrame*>
-        bufferFrames;             // List of buffer frames ptrs for chaining
-    int clockHand;                // Position of the clock hand in bufferFrames
+    double highPriorityRatio;
+    int highPriorityCapacity;  // Number of frames high-priority pages may take
+    int numHighPriorityPages;
+    bool useHugePages;  // Whether the chunks added by growing use huge pages
+
+    // The frames. After shrinking, frames past the capacity are kept until
+    // their whole chunk is past the capacity and unpinned.
+    vector<BufferFrame> bufferFrames;
+    // One policy per tier, indexed by PagePriority, so a victim is always
+    // picked from a single tier
+    array<unique_ptr<EvictionPolicy>, 2> evictionPolicies;
+    unique_ptr<AdmissionFilter> admissionFilter;  // nullptr admits every page
+    vector<int> freeFrames;  // Unpinned frames below the capacity holding no page
+
+    // The memory of the frames, PAGE_SIZE bytes per frame, in frame order
+    vector<FrameChunk> frameChunks;
+    vector<char*> frameAddresses;  // The memory of each frame
+
+    // Maps the cached pages to their frames, growing and shrinking with them
+    PageTable pageTable;
+
+    // The counters are atomic, so they can be read and reset without the lock
+    atomic<uint64_t> numHits;
+    atomic<uint64_t> numMisses;
+    atomic<uint64_t> numEvictions;
+    atomic<uint64_t> numRejections;
+    atomic<uint64_t> numProbes;
+    atomic<uint64_t> numSweepSteps;
+
+    // The hits and misses of each SST, in the order the SSTs were first
+    // looked up, along with the upper 32 bits of their page ids
+    vector<array<uint64_t, 2>> sstCounters;
+    vector<uint32_t> sstCounterKeys;
+    // Maps the upper 32 bits of the page ids of an SST to its counters, so
+    // counting a lookup reads one bucket instead of walking a node-based map
+    PageTable sstCounterIndex;
+
+    friend class PageHandle;
+
+    // Returns the KV-pairs stored in the memory of the given frame
+    array<int, 2>* frameData(int frameIdx);
+
+    // Returns the hit and miss counters of the SST of a page. Must hold
+    // shardMutex.
+    array<uint64_t, 2>& sstCounterOf(PageId pageId);
+
+    // Returns a handle pinning the given frame. Must hold shardMutex.
+    PageHandle pin(int frameIdx);
+
+    // Takes a frame for a new page, from the free frames or by evicting a
+    // page, or returns -1 if there is none. Must hold shardMutex.
+    int takeFrame(PageId pageId, PagePriority priority);
 
-    // Hashes pageId into an index of bufferFrame
-    int hashPageIdToIndex(string pageId);
+    // Gives back a frame taken for a page that was not cached. Must hold
+    // shardMutex.
+    void releaseFrame(int frameIdx);
 
-    // Evicts a page using clock
-    void evictPage();
+    // Caches the given page in a taken frame. Must hold shardMutex.
+    void insertPage(int frameIdx, PageId pageId, size_t numKVPairs, PagePriority priority);
+
+    // Drops a pin of the given frame, freeing it if its page was invalidated
+    void unpin(int frameIdx);
+
+    // Adds a chunk of frames past the last one, in the given memory or in
+    // newly mapped memory
+    void addFrames(int numFrames, FrameMemory memory = FrameMemory());
+
+    // Frees the last chunks while all their frames are past the capacity and
+    // unpinned
+    void releaseRetiredChunks();
+
+    // Returns the eviction policy tracking the page of a frame
+    EvictionPolicy& policyOf(int frameIdx);
+
+    // Removes the page of a frame from the page table and the eviction policy
+    void dropPage(int frameIdx);
+
+    // Evicts an unpinned page chosen by the eviction policy of a tier the
+    // candidate page may displace, returning the index of the freed frame,
+    // or -1 if every such frame is pinned or the candidate is not admitted
+    int evictPage(PageId candidate, PagePriority priority);
 
    public:
-    BufferPool(int capacity);
+    // The frames of the shard are kept in the given memory, which holds
+    // capacity pages
+    BufferPoolShard(int capacity, EvictionPolicyType evictionPolicyType,
+                    unique_ptr<AdmissionFilter> admissionFilter, double highPriorityRatio,
+                    bool useHugePages, FrameMemory frameMemory);
+
+    // Returns index of a page in the shard, or -1 if not found
+    int findPage(PageId pageId);
+
+    PageHandle getPage(PageId pageId);
+
+    PageHandle putPage(PageId pageId, KVSpan kvPairs, PagePriority priority);
+
+    // Reads a missing page straight into a frame, which stays out of the
+    // page table until the read completes. Returns an empty handle when no
+    // frame can be taken for the page, e.g. every frame is pinned.
+    PageHandle loadPage(PageId pageId, const PageReader& reader, PagePriority priority);
+
+    void updatePage(PageId pageId, const vector<array<int, 2>>& kvPairs);
+
+    // Drops every page whose id has the given upper 32 bits, i.e. the level
+    // and SST of the page
+    int invalidate(PageId prefix);
 
-    // Destructor to free up the allocated memory for linked lists
-    ~BufferPool();
+    // Grows or shrinks the shard to the given number of frames. Shrinking
+    // evicts the pages past the new capacity; pinned ones stay readable until
+    // their handles are released.
+    void resize(int newCapacity);
 
-    // Returns index of a page in buffer pool, or -1 if not found
+    int getCapacity();
+
+    // Returns the number of frames below the capacity backed by huge pages
+    int getNumHugePageFrames();
+
+    BufferPoolStats getStats();
+
+    // Adds the counters of each SST to the given map
+    void collectSSTStats(unordered_map<uint32_t, array<uint64_t, 2>>& sstStats);
+
+    void resetStats();
+};
+
+/**
+ * A cache of SST pages that may be shared by many reader threads. The pages
+ * are spread over independent shards by the hash of their id, so threads
+ * reading different pages rarely contend on a lock. The frames of every
+ * shard start out in one contiguous region, while their metadata is kept
+ * apart in dense arrays.
+ */
+class BufferPool {
+   private:
+    atomic<int> capacity;  // Number of buffer frames over all shards
+    vector<unique_ptr<BufferPoolShard>> shards;
+    mutex resizeMutex;  // Serializes resizes of the pool
+
+    // Returns the shard holding the given page
+    BufferPoolShard& shardOf(PageId pageId);
+
+   public:
+    /**
+     * @param capacity the number of pages over all shards
+     */
+    BufferPool(int capacity, BufferPoolOptions options = BufferPoolOptions());
+
+    // Returns index of a page in its shard, or -1 if not found
     int findPage(int sstIdx, int pageNum);
 
-    // Returns KV Pairs in a page, or empty vector if page not in buffer pool
-    vector<array<int, 2>> getPage(string pageId);
+    // Returns the page pinned in buffer pool, or an empty handle if the page
+    // is not in buffer pool
+    PageHandle getPage(PageId pageId);
+
+    // Copies a page into buffer pool and returns it pinned. With DONT_CACHE
+    // the returned handle owns a copy of the page instead.
+    PageHandle putPage(PageId pageId, KVSpan kvPairs, CacheHint hint = CacheHint::NORMAL,
+                       PagePriority priority = PagePriority::NORMAL);
 
-    // Inserts a page into buffer pool
-    void putPage(string pageId, vector<array<int, 2>> kvPairs);
+    // Reads a missing page straight into a frame of the buffer pool with the
+    // given reader, and returns it pinned, or an empty handle if there is no
+    // such page. Without a frame for the page, e.g. with DONT_CACHE, the
+    // returned handle owns a copy of the page instead.
+    PageHandle loadPage(PageId pageId, const PageReader& reader,
+                        CacheHint hint = CacheHint::NORMAL,
+                        PagePriority priority = PagePriority::NORMAL);
 
     void updatePage(int sstIdx, int pageNum, vector<array<int, 2>> kvPairs);
 
+    // Drops every page of the given SST, e.g. once it is deleted or
+    // rewritten. Pinned pages stay readable until their handles are released.
+    // Returns the number of pages dropped.
+    int invalidateSST(int sstLevel, int sstIdx);
+
     // Generates a pageId for the given sstIdx and pageNum
-    string makePageId(int sstIdx, int pageNum);
+    static PageId makePageId(int sstIdx, int pageNum);
 
-    string makeLeveledPageId(int sstLevel, int sstIdx, int pageNum);
+    static PageId makeLeveledPageId(int sstLevel, int sstIdx, int pageNum);
+
+    // Generates a pageId for a node of the index of the given sstIdx, apart
+    // from the ids of its data pages
+    static PageId makeIndexPageId(int sstIdx, int nodeNum);
+
+    // Drops every cached node of the index of the given sstIdx
+    int invalidateIndex(int sstIdx);
 
     // Returns the capacity of this buffer pool
     int getCapacity();
+
+    // Grows or shrinks the pool to the given number of frames while it is in
+    // use. The shards are resized one at a time, so only readers of the
+    // shard being resized wait.
+    void resize(int newCapacity);
+
+    int getNumShards();
+
+    // Returns the number of frames backed by huge pages
+    int getNumHugePageFrames();
+
+    // Returns the counters of the whole pool
+    BufferPoolStats getStats();
+
+    // Returns the counters of every shard
+    vector<BufferPoolStats> getShardStats();
+
+    // Returns the hits and misses of every SST read, ordered by level and SST
+    vector<SSTCacheStats> getSSTStats();
+
+    // Sets every counter back to 0
+    void resetStats();
 };
 
-#endif
\ No newline at end of file
+#endif
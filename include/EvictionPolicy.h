@@ -0,0 +1,142 @@
+#ifndef EVICTIONPOLICY_H
+#define EVICTIONPOLICY_H
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "PageId.h"
+
+using namespace std;
+
+struct BufferFrame;
+
+/**
+ * The policy choosing which page a shard of the buffer pool evicts
+ */
+enum class EvictionPolicyType {
+    // a single clock over every frame
+    CLOCK,
+    // pages read once wait in a small FIFO queue, and only pages read again
+    // after leaving it reach the main LRU queue, so a scan cannot flush the
+    // pages of point lookups
+    TWO_QUEUE
+};
+
+/**
+ * Tracks the frames of a shard to pick eviction victims. Every method is
+ * called with the lock of the shard held.
+ */
+class EvictionPolicy {
+   public:
+    virtual ~EvictionPolicy() = default;
+
+    // A page was put into the given frame
+    virtual void onInsert(int frameIdx, PageId pageId) = 0;
+
+    // The page of the given frame was read from the pool
+    virtual void onAccess(int frameIdx) = 0;
+
+    // The page of the given frame was dropped without being evicted
+    virtual void onRemove(int frameIdx) = 0;
+
+    // Returns the frame of an unpinned page to evict, or -1 if every frame
+    // is pinned, adding the number of frames examined to numSteps. The page
+    // is only evicted once onEvict is called, as the admission filter may
+    // keep it.
+    virtual int pickVictim(const vector<BufferFrame>& frames, uint64_t& numSteps) = 0;
+
+    // The page of the given frame, picked as victim, was evicted
+    virtual void onEvict(int frameIdx) = 0;
+
+    // The shard now has the given number of frames. The frames past it were
+    // removed before shrinking.
+    virtual void resize(int capacity) = 0;
+
+    static unique_ptr<EvictionPolicy> create(EvictionPolicyType type, int capacity);
+};
+
+class ClockPolicy : public EvictionPolicy {
+   private:
+    int capacity;
+    int clockHand;            // Position of the clock hand in the frames
+    vector<bool> refBits;     // Set by clock to mark page access
+    vector<bool> isTracked;   // Whether the frame holds a page to evict
+
+   public:
+    explicit ClockPolicy(int capacity);
+
+    void onInsert(int frameIdx, PageId pageId) override;
+
+    void onAccess(int frameIdx) override;
+
+    void onRemove(int frameIdx) override;
+
+    int pickVictim(const vector<BufferFrame>& frames, uint64_t& numSteps) override;
+
+    void onEvict(int frameIdx) override;
+
+    void resize(int capacity) override;
+};
+
+/**
+ * The simplified 2Q policy of Johnson and Shasha
+ */
+class TwoQueuePolicy : public EvictionPolicy {
+   private:
+    enum Queue : uint8_t { NONE, RECENT, FREQUENT };
+
+    // A doubly linked list of frames, threaded through prevFrame/nextFrame
+    struct FrameList {
+        int head = -1;  // most recently inserted
+        int tail = -1;  // least recently inserted
+        int size = 0;
+    };
+
+    int recentCapacity;  // Target size of the FIFO queue of new pages
+    int ghostCapacity;   // Number of ids remembered after leaving that queue
+
+    vector<int> prevFrame;
+    vector<int> nextFrame;
+    vector<Queue> queueOf;
+    vector<PageId> pageIdOf;
+    FrameList recent;    // Pages read once, in FIFO order
+    FrameList frequent;  // Pages read again, in LRU order
+
+    // Ids of pages evicted from the recent queue, oldest first. A page id
+    // may appear more than once, so the map counts its entries.
+    deque<PageId> ghostQueue;
+    unordered_map<PageId, int> ghostCounts;
+
+    void pushFront(FrameList& list, Queue queue, int frameIdx);
+
+    void unlink(int frameIdx);
+
+    void rememberGhost(PageId pageId);
+
+    // Forgets the oldest ghosts past the ghost capacity
+    void trimGhosts();
+
+    // Returns the unpinned frame nearest to the tail of the list, or -1
+    int findUnpinned(const FrameList& list, const vector<BufferFrame>& frames,
+                     uint64_t& numSteps);
+
+   public:
+    explicit TwoQueuePolicy(int capacity);
+
+    void onInsert(int frameIdx, PageId pageId) override;
+
+    void onAccess(int frameIdx) override;
+
+    void onRemove(int frameIdx) override;
+
+    int pickVictim(const vector<BufferFrame>& frames, uint64_t& numSteps) override;
+
+    void onEvict(int frameIdx) override;
+
+    void resize(int capacity) override;
+};
+
+#endif
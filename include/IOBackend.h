@@ -0,0 +1,170 @@
+//
+// Submits batches of page reads and writes to the SST files
+//
+
+#ifndef AVLTREEPROJECT_IOBACKEND_H
+#define AVLTREEPROJECT_IOBACKEND_H
+
+#include <sys/types.h>
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+/**
+ * How the I/O of a batch is issued
+ */
+enum class IOBackendType {
+    // a kernel submission queue shared with the device, falling back to the
+    // thread pool when the kernel does not allow io_uring or its reads and
+    // writes
+    IO_URING,
+    // worker threads issuing blocking reads and writes
+    THREAD_POOL
+};
+
+/**
+ * A read or write of a buffer at an offset of a file
+ */
+struct IORequest {
+    enum Op : uint8_t { READ, WRITE };
+
+    Op op;
+    int fd;
+    char *buffer;
+    size_t length;
+    off_t offset;
+
+    // set once the request completes: the number of bytes transferred, or
+    // -errno on failure
+    ssize_t result;
+};
+
+/**
+ * Issues batches of requests with up to a queue depth of them in flight, so
+ * the device serves them in parallel instead of one page at a time. Shared by
+ * the concurrent readers of a store.
+ */
+class IOBackend {
+public:
+    virtual ~IOBackend() = default;
+
+    /**
+     * Issues the requests and waits until all of them complete, setting
+     * their results. Batches larger than the queue depth are issued in turns.
+     */
+    virtual void submitAndWait(vector<IORequest> &theRequests) = 0;
+
+    /**
+     * @return the backend actually used, which may be the fallback
+     */
+    virtual IOBackendType getType() = 0;
+
+    /**
+     * @param theQueueDepth the number of requests in flight at once
+     */
+    static unique_ptr<IOBackend> create(IOBackendType theType, int theQueueDepth);
+};
+
+/**
+ * Runs the requests on worker threads issuing pread and pwrite
+ */
+class ThreadPoolBackend : public IOBackend {
+private:
+    /**
+     * Guards myQueue and the remaining counts of the batches
+     */
+    mutex myMutex;
+
+    condition_variable myWorkCondition;
+
+    condition_variable myDoneCondition;
+
+    /**
+     * The requests waiting for a worker, each with the count of the requests
+     * of its batch not completed yet
+     */
+    deque<pair<IORequest *, int *>> myQueue;
+
+    bool myIsStopping;
+
+    vector<thread> myWorkers;
+
+    void work();
+
+public:
+    explicit ThreadPoolBackend(int theQueueDepth);
+
+    ~ThreadPoolBackend() override;
+
+    void submitAndWait(vector<IORequest> &theRequests) override;
+
+    IOBackendType getType() override;
+};
+
+/**
+ * Issues the requests through an io_uring, without liburing: the submission
+ * and completion rings are mapped from the kernel, and a batch costs one
+ * system call to submit and wait, however many pages it reads
+ */
+class IOUringBackend : public IOBackend {
+private:
+    int myRingFd;
+
+    unsigned myQueueDepth;
+
+    /**
+     * Serializes the batches, as each one owns the rings until it completes
+     */
+    mutex myMutex;
+
+    void *mySQRing;
+    size_t mySQRingSize;
+    void *myCQRing;
+    size_t myCQRingSize;
+    void *mySQEs;
+    size_t mySQEsSize;
+
+    // the fields of the rings shared with the kernel
+    unsigned *mySQTail;
+    unsigned *mySQMask;
+    unsigned *mySQArray;
+    unsigned *myCQHead;
+    unsigned *myCQTail;
+    unsigned *myCQMask;
+    void *myCQEs;
+
+    /**
+     * Takes every batch once the kernel rejected the requests of the ring
+     * which blocking calls then completed, or nullptr while the ring works
+     */
+    unique_ptr<ThreadPoolBackend> myFallback;
+
+    explicit IOUringBackend(int theRingFd);
+
+    /**
+     * Issues at most myQueueDepth requests and reaps their completions
+     */
+    void submitChunk(IORequest *theRequests, unsigned theNumRequests);
+
+public:
+    ~IOUringBackend() override;
+
+    /**
+     * @return the backend, or nullptr if the kernel does not allow io_uring
+     * or does not support its read and write operations
+     */
+    static unique_ptr<IOUringBackend> create(int theQueueDepth);
+
+    void submitAndWait(vector<IORequest> &theRequests) override;
+
+    IOBackendType getType() override;
+};
+
+#endif  // AVLTREEPROJECT_IOBACKEND_H
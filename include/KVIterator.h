@@ -0,0 +1,127 @@
+//
+// Iterators over sorted KV-pairs
+//
+
+#ifndef AVLTREEPROJECT_KVITERATOR_H
+#define AVLTREEPROJECT_KVITERATOR_H
+
+#include <array>
+#include <vector>
+
+using namespace std;
+
+/**
+ * Iterates over KV-pairs in key order, e.g. over a memtable or an SST.
+ */
+class KVIterator {
+public:
+    virtual ~KVIterator() = default;
+
+    /**
+     * Position at the first KV-pair
+     */
+    virtual void seekToFirst() = 0;
+
+    /**
+     * Position at the first KV-pair whose key is larger than or equal to the
+     * target
+     */
+    virtual void seek(int theTarget) = 0;
+
+    /**
+     * Returns whether the iterator is positioned at a KV-pair
+     */
+    virtual bool valid() = 0;
+
+    /**
+     * Move to the next KV-pair. Only valid when valid() is true.
+     */
+    virtual void next() = 0;
+
+    /**
+     * Returns the key of the current KV-pair
+     */
+    virtual int key() = 0;
+
+    /**
+     * Returns the value of the current KV-pair
+     */
+    virtual int value() = 0;
+};
+
+/**
+ * Iterates over a sorted vector of KV-pairs. The vector must outlive the
+ * iterator.
+ */
+class VectorIterator : public KVIterator {
+private:
+    const vector<array<int, 2>> &myKVPairs;
+
+    size_t myIdx;
+
+public:
+    explicit VectorIterator(const vector<array<int, 2>> &theKVPairs);
+
+    void seekToFirst() override;
+
+    void seek(int theTarget) override;
+
+    bool valid() override;
+
+    void next() override;
+
+    int key() override;
+
+    int value() override;
+};
+
+/**
+ * Merges two iterators into one. When both contain a key, the pair from the
+ * newer iterator wins. Tombstones can optionally be dropped from the output.
+ */
+class MergingIterator : public KVIterator {
+private:
+    KVIterator &myNewer;
+
+    KVIterator &myOlder;
+
+    bool myDropTombstones;
+
+    /**
+     * The child iterator positioned at the current pair, or nullptr
+     */
+    KVIterator *myCurrent;
+
+    /**
+     * Whether the older iterator holds the same key as the current pair
+     */
+    bool myIsShadowing;
+
+    /**
+     * pick the child holding the smallest key, skipping tombstones if needed
+     */
+    void findCurrent();
+
+    /**
+     * move past the current pair in the children
+     */
+    void advance();
+
+public:
+    MergingIterator(KVIterator &theNewer, KVIterator &theOlder,
+                    bool theDropTombstones);
+
+    void seekToFirst() override;
+
+    void seek(int theTarget) override;
+
+    bool valid() override;
+
+    void next() override;
+
+    int key() override;
+
+    int value() override;
+};
+
+#endif  // AVLTREEPROJECT_KVITERATOR_H
@@ -0,0 +1,48 @@
+//
+// A read-only view over contiguous KV-pairs
+//
+
+#ifndef AVLTREEPROJECT_KVSPAN_H
+#define AVLTREEPROJECT_KVSPAN_H
+
+#include <array>
+#include <cstddef>
+#include <vector>
+
+using namespace std;
+
+/**
+ * A non-owning view over contiguous KV-pairs, such as a page cached in a
+ * buffer frame, standing in for std::span which C++17 lacks.
+ */
+class KVSpan {
+private:
+    const array<int, 2> *myData;
+
+    size_t mySize;
+
+public:
+    KVSpan() : myData(nullptr), mySize(0) {}
+
+    KVSpan(const array<int, 2> *theData, size_t theSize)
+            : myData(theData), mySize(theSize) {}
+
+    KVSpan(const vector<array<int, 2>> &theKVPairs)
+            : myData(theKVPairs.data()), mySize(theKVPairs.size()) {}
+
+    const array<int, 2> *data() const { return myData; }
+
+    size_t size() const { return mySize; }
+
+    bool empty() const { return mySize == 0; }
+
+    const array<int, 2> &operator[](size_t theIdx) const { return myData[theIdx]; }
+
+    const array<int, 2> &back() const { return myData[mySize - 1]; }
+
+    const array<int, 2> *begin() const { return myData; }
+
+    const array<int, 2> *end() const { return myData + mySize; }
+};
+
+#endif  // AVLTREEPROJECT_KVSPAN_H
@@ -35,8 +35,11 @@ class KVStore {
      * @param dBName The name of the database
      * @param bufferCapacity The maximum number of pages that the buffer pool
      * can hold
+     * @param useMmapReads whether the SSTs and their B-trees are read from
+     * mappings of their files instead of through the buffer pool
      */
-    KVStore(int memtableSize, string dBName, int bufferCapacity);
+    KVStore(int memtableSize, string dBName, int bufferCapacity,
+            bool useMmapReads = false);
 
     /**
      * Stores a key associated with a value
@@ -50,6 +53,13 @@ class KVStore {
      */
     int get(int key);
 
+    /**
+     * Retrieves a value associated with a given key without throwing when
+     * the key is missing
+     * @return the value, or nothing if the key is not in the database
+     */
+    optional<int> tryGet(int key);
+
     /**
      * retrieves all KV-pairs in a key range in key order (low < high)
      * @return A vector of KV-Pairs
@@ -77,6 +87,13 @@ class KVStore {
      * @return the value associated with the given key
      */
     int bTreeGet(int key);
+
+    /**
+     * Retrieves a value associated with a given key using B-tree search
+     * without throwing when the key is missing
+     * @return the value, or nothing if the key is not in the database
+     */
+    optional<int> bTreeTryGet(int key);
 };
 
 #endif  // AVLTREEPROJECT_KVSTORE_H
@@ -8,10 +8,18 @@
 #include <iostream>
 #include <fstream>
 #include <array>
+#include <optional>
+#include <shared_mutex>
+#include <utility>
 #include <vector>
 #include <unordered_map>
 
 #include "BufferPool.h"
+#include "IOBackend.h"
+#include "KVIterator.h"
+#include "LSMOptions.h"
+#include "Readahead.h"
+#include "TableCache.h"
 
 using namespace std;
 
@@ -20,6 +28,58 @@ using namespace std;
  */
 class LSMController {
 private:
+    /**
+     * Iterates over the KV-pairs of an SST page by page through the buffer pool
+     */
+    class SSTIterator : public KVIterator {
+    private:
+        LSMController &myController;
+
+        int myLevel;
+
+        int mySSTNum;
+
+        /**
+         * The number of the page held in myPage
+         */
+        int myPageNum;
+
+        /**
+         * The current page, pinned in the buffer pool
+         */
+        PageHandle myPage;
+
+        /**
+         * The pages read in one batch with the current one, starting at
+         * myBatchFirstPage. The pages before the current one were moved out.
+         */
+        vector<PageHandle> myBatch;
+
+        int myBatchFirstPage;
+
+        size_t myIdx;
+
+        /**
+         * read the given page of the SST into myPage
+         */
+        void loadPage(int thePageNum);
+
+    public:
+        SSTIterator(LSMController &theController, int theLevel, int theSSTNum);
+
+        void seekToFirst() override;
+
+        void seek(int theTarget) override;
+
+        bool valid() override;
+
+        void next() override;
+
+        int key() override;
+
+        int value() override;
+    };
+
     /**
      * BufferPool for SST pages
      */
@@ -35,6 +95,26 @@ private:
      */
     string myDbName;
 
+    LSMOptions myOptions;
+
+    /**
+     * Detects the SSTs read in order, by scans, compactions and lookups
+     * walking their pages, to prefetch the pages ahead of the reader. Only
+     * the pages missing from the buffer pool are reported to it.
+     */
+    Readahead myReadahead;
+
+    /**
+     * The open SST files, so a page read does not open and close its file
+     */
+    TableCache myTableCache;
+
+    /**
+     * Issues the batches of page reads and writes of scans, compactions and
+     * flushes
+     */
+    unique_ptr<IOBackend> myIOBackend;
+
     /**
      * read the metadata from the db
      * @return the number of SSTs, or -1 when no metadata exist
@@ -42,10 +122,10 @@ private:
     int readMetaData();
 
     /**
-     * update the metadata with myNumSST
+     * update the metadata with the given level map
      * @return 0 if success, -1 otherwise
      */
-    int updateMetaData();
+    int updateMetaData(const unordered_map<int, int> &theLevelMap);
 
     /**
      * generate a path to the provided filename using myDbName
@@ -53,9 +133,9 @@ private:
     string buildPath(string theFilePath);
 
     /**
-     * generate a path for an SST file at a given level
+     * get the number of the next SST saved at a given level of the level map
      */
-    string newSSTPath(int theLevel);
+    static int newSSTNum(const unordered_map<int, int> &theLevelMap, int theLevel);
 
     /**
      * generate a path for an existing SST file
@@ -65,20 +145,53 @@ private:
     string existingSSTPath(int theLevel, int theSSTNum);
 
     /**
-     * read the given page of the given SST file from the database and convert into KV-pairs
+     * read the given page of the given SST file from the database and pin it in the buffer pool
      * @param theLevel the level of the SST
      * @param thePageNum the target page of the SST
      * @param theSSTNum the index of the SST
-     * @return the KV-pairs
+     * @param theHint whether a page read from the file is cached
+     * @return the page holding the KV-pairs, which is empty past the end of the SST
+     */
+    PageHandle read(int theLevel, int thePageNum, int theSSTNum,
+                    CacheHint theHint = CacheHint::NORMAL);
+
+    /**
+     * map the given SST for reading in place, the file staying mapped while
+     * theFile is held
+     * @return the KV-pairs of the SST, or an empty span if it cannot be mapped
      */
-    vector<array<int, 2>> read(int theLevel, int thePageNum, int theSSTNum);
+    KVSpan mapSST(int theLevel, int theSSTNum, shared_ptr<OpenFile> &theFile);
+
+    /**
+     * read consecutive pages of the given SST in one batch, the pages missing
+     * from the buffer pool being read in parallel
+     * @param theFirstPage the first page to read (1-indexed)
+     * @param theHint whether the pages read from the file are cached
+     * @return the pages, which stop short at the end of the SST
+     */
+    vector<PageHandle> readPages(int theLevel, int theFirstPage, int theNumPages, int theSSTNum,
+                                 CacheHint theHint = CacheHint::NORMAL);
+
+    /**
+     * ask the kernel to read the given pages of an SST into the page cache in
+     * the background, so that the reads of these pages do not wait on the disk
+     * @param theFirstPage the first page to prefetch (1-indexed)
+     * @param theNumPages the number of pages, which may run past the end of the SST
+     */
+    void prefetch(int theLevel, int theSSTNum, int theFirstPage, int theNumPages);
+
+    /**
+     * drop the cached pages, the open file and the readahead stream of an SST
+     * which was removed or is about to be rewritten
+     */
+    void forgetSST(int theLevel, int theSSTNum);
 
     /**
      * perform a binary search on the given KV-Pairs
      * @param theTarget
      * @return the index of the target, or -1 if target not found
      */
-    static int searchSST(const vector<array<int, 2>> &theKVPairs, int theTarget);
+    static int searchSST(KVSpan theKVPairs, int theTarget);
 
     /**
      * perform a binary search on the given KV-Pairs and return the smallest element that is larger than or equal to
@@ -86,30 +199,48 @@ private:
      * @param theTarget
      * @return the index of the smallest element that is larger than or equal to the target, or -1 if target not found
      */
-    static int searchSSTSmallestLarger(const vector<array<int, 2>> &theKVPairs, int theTarget);
+    static int searchSSTSmallestLarger(KVSpan theKVPairs, int theTarget);
 
     /**
-     * perform compaction in the DB
+     * perform compaction in the DB, merging the levels of the given level map
+     * holding 2 SSTs
+     * @param theStaleSSTs gets the level and number of every merged SST, to be
+     * removed once the level map is installed
+     * @return whether the compaction is success
      */
-    int performCompaction();
+    bool performCompaction(unordered_map<int, int> &theLevelMap,
+                           vector<pair<int, int>> &theStaleSSTs);
 
     /**
-     * Save the sst without triggering compaction
-     * @param theKVPairs the KV-pairs to be saved.
-     * @param theLevel the level to be inserted.
-     * @return whether the save is success
+     * make the given level map the one the readers see, then remove the stale
+     * SSTs
+     * @param theReadersMutex the lock of the readers, held only while the
+     * level map is replaced, or nullptr when there are no concurrent readers
      */
-    bool performSave(vector<array<int, 2>> theKVPairs, int theLevel);
+    void installSSTs(unordered_map<int, int> theLevelMap,
+                     const vector<pair<int, int>> &theStaleSSTs, shared_mutex *theReadersMutex);
 
     /**
-     * Invalidate all pages in the buffer pool
+     * Save the sst without triggering compaction. The KV-pairs are streamed
+     * from the iterator page by page, starting at its current position.
+     * @param theIterator the KV-pairs to be saved.
+     * @param theLevelMap the level map the SST is added to
+     * @param theLevel the level to be inserted.
+     * @param theIsCachingPages whether the written pages are put into the buffer pool
+     * @param theNumKVPairs an estimate of the number of KV-pairs, used to
+     * preallocate the SST, or 0 when unknown
      * @return whether the save is success
      */
-    int invalidateBufferPool();
+    bool performSave(KVIterator &theIterator, unordered_map<int, int> &theLevelMap, int theLevel,
+                     bool theIsCachingPages = false, size_t theNumKVPairs = 0);
 
 public:
 
-    explicit LSMController(string theDbName, int bufferPoolCapacity);
+    /**
+     * @param theOptions the buffer pool options of the store
+     */
+    explicit LSMController(string theDbName, int bufferPoolCapacity,
+                           LSMOptions theOptions = LSMOptions());
 
     /**
      * Get the most up-to-date value of the given key from all SSTs.
@@ -118,6 +249,12 @@ public:
      */
     pair<bool, int> get(int theKey);
 
+    /**
+     * Get the most up-to-date value of the given key from all SSTs.
+     * @return the value found, or nothing when the key is not in any SST
+     */
+    optional<int> tryGet(int theKey);
+
     /**
      * Retrieves all KV-pairs in a key range in key order (high < low)
      */
@@ -130,6 +267,19 @@ public:
      */
     bool save(vector<array<int, 2>> theKVPairs, int theLevel);
 
+    /**
+     * Save the KV-pairs of the iterator, starting at its current position, as
+     * a SST to a given level in the database
+     * @param theIterator
+     * @param theNumKVPairs an estimate of the number of KV-pairs, used to
+     * preallocate the SST, or 0 when unknown
+     * @param theReadersMutex the lock of the readers, which keep going while
+     * the SSTs are written and compacted, as it is only held to install them
+     * @return whether the save is success
+     */
+    bool save(KVIterator &theIterator, int theLevel, size_t theNumKVPairs = 0,
+              shared_mutex *theReadersMutex = nullptr);
+
     /**
      * deletes the sst files
      * @return whether the delete was successful
@@ -141,6 +291,26 @@ public:
      */
      unordered_map<int, int> getMetadata();
 
+    /**
+     * Return the counters of the buffer pool
+     */
+    BufferPoolStats getBufferPoolStats();
+
+    /**
+     * Return the buffer pool hits and misses of every SST, by level
+     */
+    vector<SSTCacheStats> getSSTCacheStats();
+
+    /**
+     * Set the counters of the buffer pool back to 0
+     */
+    void resetBufferPoolStats();
+
+    /**
+     * Grow or shrink the buffer pool to the given number of pages
+     */
+    void resizeBufferPool(int theCapacity);
+
     /**
      * close the LSM tree and store the metadata
      */
@@ -0,0 +1,67 @@
+//
+// Tunables of the LSM store
+//
+
+#ifndef AVLTREEPROJECT_LSMOPTIONS_H
+#define AVLTREEPROJECT_LSMOPTIONS_H
+
+#include "BufferPool.h"
+#include "IOBackend.h"
+#include "Memtable.h"
+#include "SSTWriter.h"
+#include "TableCache.h"
+#include "WriteAheadLog.h"
+
+/**
+ * Options used when opening an LSMStore
+ */
+struct LSMOptions {
+    // The data structure backing the memtable
+    MemtableType memtableType = MemtableType::AVL_TREE;
+
+    // The number of full memtables waiting for the flush thread before
+    // writers stall
+    int maxImmutableMemtables = 2;
+
+    // When the write-ahead log is forced to disk
+    WALSyncMode walSyncMode = WALSyncMode::PERIODIC;
+
+    // The interval between two syncs of the log in the periodic sync mode
+    int walSyncIntervalMs = 100;
+
+    // Whether the SSTs written by a compaction are put into the buffer pool,
+    // keeping reads warm after it at the cost of evicting older pages
+    bool cacheCompactionOutput = false;
+
+    // The largest number of pages prefetched ahead of a sequential reader of
+    // an SST, or 0 to disable readahead
+    int readaheadMaxPages = 64;
+
+    // The number of SST files kept open between reads
+    int maxOpenFiles = DEFAULT_MAX_OPEN_FILES;
+
+    // Whether SSTs are read and written with O_DIRECT, bypassing the kernel
+    // page cache so the buffer pool is the only cache of their pages. Falls
+    // back to buffered I/O on file systems rejecting O_DIRECT.
+    bool useDirectIO = false;
+
+    // How batches of SST pages are read, and how many requests of a batch
+    // are in flight at once
+    IOBackendType ioBackend = IOBackendType::IO_URING;
+    int ioQueueDepth = 32;
+
+    // The size of the buffer through which a new SST is written, the SST
+    // being written with one call per full buffer
+    size_t writeBufferSize = DEFAULT_WRITE_BUFFER_SIZE;
+
+    // Whether lookups read the SSTs from mappings of their files instead of
+    // through the buffer pool. Each SST is mapped once and searched in place,
+    // so a read-mostly data set fitting in memory is read without copies or
+    // system calls.
+    bool useMmapReads = false;
+
+    // The sharding, eviction and admission of the buffer pool
+    BufferPoolOptions bufferPoolOptions;
+};
+
+#endif  // AVLTREEPROJECT_LSMOPTIONS_H
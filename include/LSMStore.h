@@ -5,10 +5,19 @@
 #ifndef AVLTREEPROJECT_LSMSTORE_H
 #define AVLTREEPROJECT_LSMTORE_H
 
+#include <array>
+#include <condition_variable>
+#include <deque>
 #include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
 
 #include "./AVLTree.h"
 #include "./LSMController.h"
+#include "./LSMOptions.h"
+#include "./Memtable.h"
+#include "./WriteAheadLog.h"
 
 /**
  * Represents the entire KV store.
@@ -17,14 +26,126 @@ class LSMStore {
 private:
     int myMemtableSize;
 
-    shared_ptr<AVLTree> myMemtable;
+    LSMOptions myOptions;
+
+    /**
+     * The memtable taking the writes
+     */
+    shared_ptr<Memtable> myMemtable;
+
+    /**
+     * Full memtables waiting to be flushed, from oldest to newest. They are
+     * still searched by get and scan until their SST is saved.
+     */
+    deque<shared_ptr<Memtable>> myImmutableMemtables;
+
+    /**
+     * Flushed memtables kept for reuse, so their arenas are not reallocated
+     */
+    vector<shared_ptr<Memtable>> myFreeMemtables;
 
     shared_ptr<LSMController> myLSMController;
 
+    /**
+     * Logs every put until its memtable is saved. Appended to under
+     * myMemtableMutex, so each segment matches one memtable.
+     */
+    shared_ptr<WriteAheadLog> myWAL;
+
+    /**
+     * Guards myMemtable and myImmutableMemtables. Writers of a concurrent
+     * memtable and all readers take it shared; swapping a memtable takes it
+     * exclusively.
+     */
+    shared_mutex myMemtableMutex;
+
+    /**
+     * Stripes of locks over the keys, taken by the concurrent writers of a
+     * skip list around the insert and the log append of a key, so the puts
+     * of a key reach the log in the order they were applied
+     */
+    static const int NUM_KEY_LOCKS = 64;
+    array<mutex, NUM_KEY_LOCKS> myKeyLocks;
+
+    /**
+     * Guards the LSM controller. Readers take it shared, as its buffer pool is
+     * thread-safe; the flush thread takes it exclusively to add SSTs.
+     */
+    shared_mutex myLSMControllerMutex;
+
+    /**
+     * Guards the flush queue state below. Always taken before myMemtableMutex.
+     */
+    mutex myFlushMutex;
+
+    /**
+     * Signalled whenever a memtable is queued or flushed
+     */
+    condition_variable myFlushCondition;
+
+    /**
+     * Whether the flush thread should exit once the queue is drained
+     */
+    bool myIsStopping;
+
+    /**
+     * Whether the flush thread stopped with memtables left unsaved, after
+     * failing to save the oldest one
+     */
+    bool myHasFlushFailed;
+
+    /**
+     * The background thread saving immutable memtables into SSTs
+     */
+    thread myFlushThread;
+
     static vector<array<int, 2>> mergeScanResults(
             const vector<array<int, 2>> &scanMem,
             const vector<array<int, 2>> &scanSST);
 
+    /**
+     * Merges the scan results of two memtables, keeping the tombstones
+     */
+    static vector<array<int, 2>> mergeMemtableScans(
+            const vector<array<int, 2>> &scanNewer,
+            const vector<array<int, 2>> &scanOlder);
+
+    /**
+     * Creates an empty memtable of the type selected in the options, reusing
+     * a flushed one when possible. Must hold myFlushMutex.
+     */
+    shared_ptr<Memtable> newMemtable();
+
+    /**
+     * Moves the given full memtable into the flush queue and replaces it with
+     * an empty one, waiting while the queue is full. Does nothing if another
+     * writer has already replaced it.
+     */
+    void rotateMemtable(const shared_ptr<Memtable> &theMemtable);
+
+    /**
+     * Inserts the KV-pair into the active memtable and appends it to the log
+     * @return the sequence number of its log record
+     */
+    uint64_t insert(int key, int value);
+
+    /**
+     * Replays the log left by the previous run into the memtables, building
+     * them in bulk from the sorted records, and reports the replay throughput
+     */
+    void recoverLog();
+
+    /**
+     * The loop of the flush thread. A memtable failing to be saved is
+     * retried with a growing backoff, blocking the ones behind it.
+     */
+    void flushMemtables();
+
+    /**
+     * Waits until every queued memtable is flushed and stops the flush thread
+     */
+    void stopFlushThread();
+
 public:
     /**
      * Constructs a KVStore object with the specified parameters.
@@ -32,8 +153,14 @@ public:
      * @param dBName The name of the database
      * @param bufferCapacity The maximum number of pages that the buffer pool
      * can hold
+     * @param options Tunables of the store, e.g. the memtable type
      */
-    LSMStore(int memtableSize, string dBName, int bufferCapacity);
+    LSMStore(int memtableSize, string dBName, int bufferCapacity,
+             LSMOptions options = LSMOptions());
+
+    // Flushes the queued memtables and stops the flush thread. The active
+    // memtable is left in the log to be replayed on the next open.
+    ~LSMStore();
 
     /**
      * Stores a key associated with a value
@@ -47,6 +174,13 @@ public:
      */
     int get(int key);
 
+    /**
+     * Retrieves a value associated with a given key without throwing when
+     * the key is missing or deleted
+     * @return the value, or nothing if the key is not in the database
+     */
+    optional<int> tryGet(int key);
+
     /**
      * Retrieves all KV-pairs in a key range in key order (low < high)
      * @return A vector of KV-Pairs
@@ -68,6 +202,28 @@ public:
      * Delete the database and all its files
      */
     void deleteDb();
+
+    /**
+     * Return the counters of the buffer pool, e.g. its hit rate
+     */
+    BufferPoolStats getBufferPoolStats();
+
+    /**
+     * Return the buffer pool hits and misses of every SST, by level
+     */
+    vector<SSTCacheStats> getSSTCacheStats();
+
+    /**
+     * Set the counters of the buffer pool back to 0, e.g. between the phases
+     * of an experiment
+     */
+    void resetBufferPoolStats();
+
+    /**
+     * Grow or shrink the buffer pool to the given number of pages while the
+     * store is in use, e.g. to hand memory back when reads are rare
+     */
+    void resizeBufferPool(int bufferCapacity);
 };
 
 #endif  // AVLTREEPROJECT_LSMSTORE_H
@@ -0,0 +1,95 @@
+//
+// The interface shared by the memtable implementations
+//
+
+#ifndef AVLTREEPROJECT_MEMTABLE_H
+#define AVLTREEPROJECT_MEMTABLE_H
+
+#include <array>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include "KVIterator.h"
+
+using namespace std;
+
+/**
+ * The data structures that can back the memtable of a store.
+ */
+enum class MemtableType {
+    AVL_TREE,   // single-writer AVL tree
+    SKIP_LIST,  // lock-free skip list supporting concurrent writers
+};
+
+/**
+ * The in-memory table of the KV store, holding the most recent KV-pairs
+ * until they are flushed into an SST.
+ */
+class Memtable {
+public:
+    virtual ~Memtable() = default;
+
+    /**
+     * Insert the KV-Pair and returns whether the memtable is full
+     * @return 0 if successfully inserted, 1 if the memtable is full
+     */
+    virtual bool insert(int key, int value) = 0;
+
+    /**
+     * Insert the KV-Pair unless the memtable is already full
+     * @return whether the KV-Pair was inserted
+     */
+    virtual bool tryInsert(int key, int value) = 0;
+
+    /**
+     * Returns whether the memtable has reached its capacity
+     */
+    virtual bool isFull() = 0;
+
+    /**
+     * Returns the value of the key. Throws exception when the key is not found.
+     */
+    virtual int getValue(int key) = 0;
+
+    /**
+     * Returns the value of the key, or nothing when the key is not found
+     */
+    virtual optional<int> tryGet(int key) = 0;
+
+    /**
+     * Retrieves all KV-Pairs in a key range in key order (low < high)
+     */
+    virtual vector<array<int, 2>> scan(int low, int high) = 0;
+
+    /**
+     * Retrieves all KV-Pairs in key order
+     */
+    virtual vector<array<int, 2>> scan() = 0;
+
+    /**
+     * Returns an iterator over the KV-Pairs in key order. The memtable must
+     * not be cleared while the iterator is in use.
+     */
+    virtual unique_ptr<KVIterator> newIterator() = 0;
+
+    /**
+     * Fill an empty memtable with KV-Pairs sorted by unique keys in O(n),
+     * without searching for the position of each pair. At most the capacity
+     * of the memtable may be loaded, and no other thread may access it.
+     */
+    virtual void bulkLoad(const array<int, 2> *kvPairs, size_t count) = 0;
+
+    /**
+     * Remove every KV-Pair from the memtable so that it can be reused
+     */
+    virtual void clear() = 0;
+
+    /**
+     * Returns whether insert and lookups may be called from several threads
+     * at the same time
+     */
+    virtual bool isConcurrent() = 0;
+};
+
+#endif  // AVLTREEPROJECT_MEMTABLE_H
@@ -0,0 +1,21 @@
+#ifndef PAGEID_H
+#define PAGEID_H
+
+#include <cstdint>
+
+/**
+ * A page id packs the level (16 bits), the SST (16 bits) and the page number
+ * (32 bits) into one integer, so looking a page up never allocates.
+ */
+typedef uint64_t PageId;
+
+// Mixes the bits of a page id (the splitmix64 finalizer), as consecutive
+// pages of an SST only differ in their lowest bits
+inline uint64_t hashPageId(PageId pageId) {
+    uint64_t hash = pageId;
+    hash = (hash ^ (hash >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    hash = (hash ^ (hash >> 27)) * 0x94d049bb133111ebULL;
+    return hash ^ (hash >> 31);
+}
+
+#endif
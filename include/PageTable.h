@@ -0,0 +1,84 @@
+#ifndef PAGETABLE_H
+#define PAGETABLE_H
+
+#include <cstdint>
+#include <vector>
+
+#include "PageId.h"
+
+using namespace std;
+
+/**
+ * An entry of the page table, mapping a page id to the frame holding it
+ */
+struct PageTableSlot {
+    PageId pageId;
+    int frameIdx;
+};
+
+/**
+ * A bucket of the page table, holding the pages whose hashes end with the
+ * same localDepth bits. A bucket spans two cache lines.
+ */
+struct alignas(64) PageTableBucket {
+    static constexpr int SLOTS = 7;
+    int localDepth;
+    int numSlotsUsed;
+    PageTableSlot slots[SLOTS];
+};
+
+/**
+ * Maps page ids to frames with extendible hashing: the last globalDepth
+ * bits of the hash of a page index a directory of buckets. A full bucket is
+ * split in two, doubling the directory when the bucket is already indexed
+ * by every bit, and nearly empty buddies are merged back, halving the
+ * directory once no bucket needs its last bit. A lookup thus reads one
+ * directory entry and one bucket, whatever the number of pages.
+ */
+class PageTable {
+   private:
+    int globalDepth;
+    vector<int> directory;  // 2^globalDepth bucket indices
+    vector<PageTableBucket> buckets;
+    vector<int> freeBuckets;  // Indices of merged buckets, to be reused
+
+    // The number of buckets whose local depth is the global depth. The
+    // directory can be halved once it drops to 0.
+    int numDeepestBuckets;
+
+    // Returns the bucket holding the given hash
+    int bucketOf(uint64_t hash);
+
+    // Returns a new empty bucket with the given local depth
+    int newBucket(int localDepth);
+
+    // Splits a full bucket on its next bit, doubling the directory if needed
+    void splitBucket(int bucketIdx);
+
+    // Merges the bucket holding the given hash into its buddy while both
+    // nearly fit in one bucket
+    void mergeBucket(uint64_t hash);
+
+    // Halves the directory while no bucket uses its last bit
+    void shrinkDirectory();
+
+   public:
+    PageTable();
+
+    // Returns the frame holding the page, or -1 if absent. The number of
+    // slots compared is added to numProbes if given.
+    int find(PageId pageId, uint64_t* numProbes = nullptr);
+
+    // Maps a page, which must not be in the table, to a frame
+    void insert(PageId pageId, int frameIdx);
+
+    // Removes a page, which must be in the table
+    void erase(PageId pageId);
+
+    int getGlobalDepth();
+
+    // Returns the number of buckets in use
+    int getNumBuckets();
+};
+
+#endif
@@ -0,0 +1,78 @@
+//
+// Detects sequential reads of SST pages to prefetch the pages ahead of them
+//
+
+#ifndef AVLTREEPROJECT_READAHEAD_H
+#define AVLTREEPROJECT_READAHEAD_H
+
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+
+using namespace std;
+
+/**
+ * A range of pages of an SST to prefetch, empty when numPages is 0
+ */
+struct ReadaheadRange {
+    int firstPage;
+    int numPages;
+};
+
+/**
+ * Tracks the pages read from each SST. Once an SST is read in order, the
+ * pages ahead of the reader are prefetched in windows which double, up to a
+ * maximum, as long as the reads stay sequential. The next window is issued
+ * when the reader enters the second half of the current one, so the I/O
+ * overlaps the reads. A read out of order falls back to the smallest window.
+ */
+class Readahead {
+private:
+    /**
+     * The sequential reads of one SST
+     */
+    struct Stream {
+        // the page a sequential reader reads next
+        int nextPage;
+
+        // the pages before this one are prefetched
+        int prefetchedUntil;
+
+        int windowPages;
+    };
+
+    int myMinWindowPages;
+
+    int myMaxWindowPages;
+
+    /**
+     * Guards myStreams, as the readers of the store run concurrently
+     */
+    mutex myMutex;
+
+    /**
+     * The streams, keyed by the level and the number of the SST
+     */
+    unordered_map<uint32_t, Stream> myStreams;
+
+    static uint32_t streamKey(int theLevel, int theSSTNum);
+
+public:
+    /**
+     * @param theMaxWindowPages the largest window, or 0 to disable readahead
+     */
+    explicit Readahead(int theMaxWindowPages);
+
+    /**
+     * Records a read of the given page of an SST (1-indexed)
+     * @return the pages to prefetch now
+     */
+    ReadaheadRange onRead(int theLevel, int theSSTNum, int thePageNum);
+
+    /**
+     * Forgets the reads of an SST which was removed or rewritten
+     */
+    void forget(int theLevel, int theSSTNum);
+};
+
+#endif  // AVLTREEPROJECT_READAHEAD_H
@@ -8,9 +8,11 @@
 #include <array>
 #include <fstream>
 #include <iostream>
+#include <optional>
 #include <vector>
 
 #include "BufferPool.h"
+#include "TableCache.h"
 
 using namespace std;
 
@@ -24,6 +26,17 @@ class SSTController {
      */
     BufferPool bufferPool;
 
+    /**
+     * The open SST files, and those of their indexes
+     */
+    TableCache myTableCache;
+
+    /**
+     * Whether the SSTs and their indexes are read from mappings of their
+     * files instead of through the buffer pool
+     */
+    bool myUseMmapReads;
+
     /**
      * The number of SSTs in the database
      */
@@ -69,11 +82,19 @@ class SSTController {
      * @return the index of the smallest element that is larger than or equal to
      * the target, or -1 if target not found
      */
-    int searchSSTSmallestLarger(const vector<array<int, 2>> &theKVPairs,
-                                int theTarget);
+    int searchSSTSmallestLarger(KVSpan theKVPairs, int theTarget);
+
+    /**
+     * map the given SST for reading in place, the file staying mapped while
+     * theFile is held
+     * @return the KV-pairs of the SST, or an empty span if it cannot be mapped
+     */
+    KVSpan mapSST(int theSSTIdx, shared_ptr<OpenFile> &theFile);
 
    public:
-    explicit SSTController(string theDbName, int bufferPoolCapacity);
+    explicit SSTController(string theDbName, int bufferPoolCapacity,
+                           int theMaxOpenFiles = DEFAULT_MAX_OPEN_FILES,
+                           bool theUseMmapReads = false);
 
     /**
      * Get the most up-to-date value of the given key from all SSTs.
@@ -83,6 +104,12 @@ class SSTController {
      */
     pair<bool, int> get(int theKey);
 
+    /**
+     * Get the most up-to-date value of the given key from all SSTs.
+     * @return the value found, or nothing when the key is not in any SST
+     */
+    optional<int> tryGet(int theKey);
+
     /**
      * Retrieves all KV-pairs in a key range in key order (high < low)
      */
@@ -102,15 +129,27 @@ class SSTController {
      */
     vector<array<int, 2>> readSST(int theSSTIdx);
 
-    // Returns the KV-pairs in an SST page
-    vector<array<int, 2>> readSSTPage(int sstIdx, int page);
+    // Returns an SST page pinned in the buffer pool, or read in place from
+    // the mapped SST in the memory-mapped mode
+    PageHandle readSSTPage(int sstIdx, int page);
+
+    // Returns whether the SSTs and their indexes are read from mappings
+    bool isUsingMmapReads() const;
+
+    // Returns the buffer pool caching the SST pages, which the indexes of
+    // the SSTs share
+    BufferPool& getBufferPool();
+
+    // Returns the cache of the open SST files, which the indexes of the SSTs
+    // share
+    TableCache& getTableCache();
 
     /**
      * perform a binary search on the given KV-Pairs
      * @param theTarget
      * @return the index of the target, or -1 if target not found
      */
-    int searchSST(const vector<array<int, 2>> &theKVPairs, int theTarget);
+    int searchSST(KVSpan theKVPairs, int theTarget);
 
     /**
      * deletes the sst files
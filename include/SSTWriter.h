@@ -0,0 +1,96 @@
+//
+// Streams the pages of a new SST to its file
+//
+
+#ifndef AVLTREEPROJECT_SSTWRITER_H
+#define AVLTREEPROJECT_SSTWRITER_H
+
+#include <sys/types.h>
+
+#include <array>
+#include <cstddef>
+
+using namespace std;
+
+// the default size of the write buffer of an SST writer
+const size_t DEFAULT_WRITE_BUFFER_SIZE = 1 << 20;
+
+/**
+ * Writes an SST through one large aligned buffer: the pages are filled in
+ * place in the buffer, which is written with a single system call whenever it
+ * is full. The file is preallocated up front, and the written ranges are
+ * handed to writeback as they go, so the final sync only waits for the tail
+ * instead of starting the writeback of the whole SST.
+ */
+class SSTWriter {
+private:
+    int myFd;
+
+    /**
+     * Whether the file was opened with O_DIRECT, so the last page is padded
+     * to a whole page and the file truncated afterwards
+     */
+    bool myIsDirect;
+
+    char *myBuffer;
+
+    size_t myBufferSize;
+
+    // the bytes of the buffer filled with pages
+    size_t myNumBufferedBytes;
+
+    // the offset of the file at which the buffer is written
+    off_t myBufferOffset;
+
+    // the bytes of KV-pairs added
+    off_t mySize;
+
+    /**
+     * Writes the buffered pages, then starts their writeback
+     */
+    bool flushBuffer();
+
+public:
+    /**
+     * @param theFd the file, which the caller keeps open until finish()
+     * @param theBufferSize rounded up to whole pages
+     */
+    SSTWriter(int theFd, bool theIsDirect, size_t theBufferSize = DEFAULT_WRITE_BUFFER_SIZE);
+
+    ~SSTWriter();
+
+    SSTWriter(const SSTWriter &) = delete;
+    SSTWriter &operator=(const SSTWriter &) = delete;
+
+    /**
+     * Reserves the blocks of an SST of the given number of KV-pairs, so the
+     * file does not grow one block at a time. An estimate: the file size
+     * stays that of the pages written.
+     */
+    void preallocate(size_t theNumKVPairs);
+
+    /**
+     * @return room for a page of KV-pairs in the buffer, or nullptr if
+     * writing out the full buffer failed
+     */
+    array<int, 2> *nextPage();
+
+    /**
+     * Adds the page returned by the last nextPage(), holding the given number
+     * of KV-pairs. Every page but the last one must be full.
+     */
+    void addPage(size_t theNumKVPairs);
+
+    /**
+     * Writes the buffered pages and forces the SST to disk
+     * @return whether the SST was written
+     */
+    bool finish();
+
+    /**
+     * @return the bytes of KV-pairs added so far
+     */
+    off_t size() const;
+};
+
+#endif  // AVLTREEPROJECT_SSTWRITER_H
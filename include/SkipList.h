@@ -0,0 +1,187 @@
+//
+// A lock-free skip list memtable
+//
+
+#ifndef AVLTREEPROJECT_SKIPLIST_H
+#define AVLTREEPROJECT_SKIPLIST_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+#include "Memtable.h"
+
+using namespace std;
+
+/**
+ * The maximum number of levels of a skip list node. With a branching factor
+ * of 4 this comfortably covers memtables of millions of KV-pairs.
+ */
+constexpr int SKIP_LIST_MAX_HEIGHT = 12;
+
+/**
+ * Represents a node in the skip list. Successors are referenced by their index
+ * in the node arena of the skip list.
+ */
+struct SkipListNode {
+    int key;
+    atomic<int> value;
+    int height;
+    atomic<uint32_t> next[SKIP_LIST_MAX_HEIGHT];
+};
+
+/**
+ * A skip list representing the memtable of the KV store.
+ *
+ * Nodes are linked in with compare-and-swap, so any number of threads may
+ * insert at the same time, and readers never block or retry. Nodes are never
+ * removed individually; the whole list is reset with clear() once it has been
+ * flushed, which must not race with other operations.
+ */
+class SkipList : public Memtable {
+public:
+    /**
+     * The index representing the absence of a node
+     */
+    static constexpr uint32_t NIL = UINT32_MAX;
+
+    /**
+     * Iterates over the bottom level of the skip list. Pairs inserted while
+     * iterating may or may not be visited.
+     */
+    class Iterator : public KVIterator {
+    private:
+        SkipList &myList;
+
+        uint32_t myNode;
+
+    public:
+        explicit Iterator(SkipList &theList);
+
+        void seekToFirst() override;
+
+        void seek(int theTarget) override;
+
+        bool valid() override;
+
+        void next() override;
+
+        int key() override;
+
+        int value() override;
+    };
+
+    explicit SkipList(int capacity);
+
+    /**
+     * Insert the KV-Pair and returns whether the skip list is full
+     * @return 0 if successfully inserted, 1 if the skip list is full
+     */
+    bool insert(int key, int value) override;
+
+    /**
+     * Insert the KV-Pair unless the skip list is already full
+     * @return whether the KV-Pair was inserted
+     */
+    bool tryInsert(int key, int value) override;
+
+    /**
+     * Returns whether the skip list has reached its capacity
+     */
+    bool isFull() override;
+
+    /**
+     * Returns the value of the key. Throws exception when the key is not found.
+     */
+    int getValue(int key) override;
+
+    /**
+     * Returns the value of the key, or nothing when the key is not found
+     */
+    optional<int> tryGet(int key) override;
+
+    /**
+     * Retrieves all KV-Pairs in a key range in key order (low < high)
+     */
+    vector<array<int, 2>> scan(int low, int high) override;
+
+    /**
+     * Retrieves all KV-Pairs in key order
+     */
+    vector<array<int, 2>> scan() override;
+
+    /**
+     * Returns an iterator over the skip list
+     */
+    unique_ptr<KVIterator> newIterator() override;
+
+    /**
+     * Link the sorted KV-Pairs in one pass, keeping the last node of every
+     * level instead of searching from the head
+     */
+    void bulkLoad(const array<int, 2> *kvPairs, size_t count) override;
+
+    /**
+     * Remove every KV-Pair from the skip list in O(1)
+     */
+    void clear() override;
+
+    /**
+     * The skip list supports concurrent writers and readers
+     */
+    bool isConcurrent() override;
+
+    /**
+     * Returns the number of inserts accepted so far
+     */
+    int getSize();
+
+private:
+    /**
+     * The index of the head sentinel node in the arena
+     */
+    static constexpr uint32_t HEAD = 0;
+
+    /**
+     * The maximum number of inserts
+     */
+    int myCapacity;
+
+    /**
+     * The number of inserts accepted so far
+     */
+    atomic<int> mySize;
+
+    /**
+     * The number of nodes allocated from the arena, including the head
+     */
+    atomic<uint32_t> myNumNodes;
+
+    /**
+     * The arena holding every node, with one node per insert plus the head
+     */
+    unique_ptr<SkipListNode[]> myNodes;
+
+    /**
+     * allocate a node from the arena and return its index
+     */
+    uint32_t allocateNode(int key, int value, int height);
+
+    /**
+     * draw a random height for a new node
+     */
+    static int randomHeight();
+
+    /**
+     * find the predecessors and successors of the key on every level
+     * @return whether a node with the key exists
+     */
+    bool findNode(int key, uint32_t *thePreds, uint32_t *theSuccs);
+
+    /**
+     * return the first node whose key is larger than or equal to the given key
+     */
+    uint32_t findGreaterOrEqual(int key);
+};
+
+#endif  // AVLTREEPROJECT_SKIPLIST_H
@@ -0,0 +1,152 @@
+//
+// Keeps the files of SSTs and their indexes open between reads
+//
+
+#ifndef AVLTREEPROJECT_TABLECACHE_H
+#define AVLTREEPROJECT_TABLECACHE_H
+
+#include <sys/types.h>
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+using namespace std;
+
+// the number of files kept open when no other bound is given
+const int DEFAULT_MAX_OPEN_FILES = 64;
+
+/**
+ * Opens a file, with O_DIRECT when asked, falling back to buffered I/O when
+ * the file system rejects O_DIRECT
+ * @param theIsDirect set to whether the file was opened with O_DIRECT
+ * @return the descriptor, or -1 if the file cannot be opened
+ */
+int openFile(const string &thePath, int theFlags, bool theUseDirectIO, bool &theIsDirect,
+             mode_t theMode = 0);
+
+/**
+ * A file opened for reading, closed once the table cache and every reader
+ * holding it let go of it. The files are immutable once written, so a file
+ * can also be mapped once and read in place.
+ */
+class OpenFile {
+private:
+    int myFd;
+
+    /**
+     * Guards the mapping, created by the first reader asking for it
+     */
+    mutex myMappingMutex;
+
+    const char *myMapping;
+
+    size_t myMappedSize;
+
+    bool myIsMapped;
+
+    /**
+     * Whether the file was opened with O_DIRECT, so reads of it must use
+     * aligned buffers, offsets and lengths
+     */
+    bool myIsDirect;
+
+public:
+    OpenFile(int theFd, bool theIsDirect);
+
+    OpenFile(const OpenFile &) = delete;
+
+    OpenFile &operator=(const OpenFile &) = delete;
+
+    ~OpenFile();
+
+    int fd() const { return myFd; }
+
+    bool isDirect() const { return myIsDirect; }
+
+    /**
+     * Maps the whole file for reading, advising the kernel of the given
+     * access pattern (e.g. MADV_RANDOM) the first time
+     * @param theSize set to the size of the file
+     * @return the mapped file, or nullptr if it is empty or cannot be mapped
+     */
+    const char *map(int theAdvice, size_t &theSize);
+};
+
+/**
+ * A bounded cache of open files keyed by path, evicting the least recently
+ * used one when full. A reader keeps the file it acquired open even if the
+ * cache evicts it meanwhile. A file must be evicted once it is removed or
+ * rewritten, as its descriptor would still read the old contents.
+ */
+class TableCache {
+private:
+    struct Entry {
+        shared_ptr<OpenFile> file;
+
+        // the position of the path in myLRU
+        list<string>::iterator lruPosition;
+    };
+
+    int myCapacity;
+
+    /**
+     * Whether the files are opened with O_DIRECT
+     */
+    bool myUseDirectIO;
+
+    /**
+     * Guards every member below, as the readers of the store run concurrently
+     */
+    mutex myMutex;
+
+    /**
+     * The cached paths, most recently used first
+     */
+    list<string> myLRU;
+
+    unordered_map<string, Entry> myEntries;
+
+    /**
+     * The number of files opened, i.e. of acquisitions missing the cache
+     */
+    uint64_t myNumOpens;
+
+public:
+    /**
+     * @param theCapacity the number of files kept open
+     * @param theUseDirectIO whether the files are opened with O_DIRECT
+     */
+    explicit TableCache(int theCapacity = DEFAULT_MAX_OPEN_FILES, bool theUseDirectIO = false);
+
+    /**
+     * Returns the file at the given path, opening it if it is not cached
+     * @return the open file, or nullptr if it cannot be opened
+     */
+    shared_ptr<OpenFile> acquire(const string &thePath);
+
+    /**
+     * Closes the file at the given path once its readers are done with it
+     */
+    void evict(const string &thePath);
+
+    /**
+     * Evicts every file, e.g. before the files are deleted
+     */
+    void clear();
+
+    /**
+     * @return the number of files in the cache
+     */
+    int size();
+
+    /**
+     * @return the number of files opened since the cache was created
+     */
+    uint64_t getNumOpens();
+};
+
+#endif  // AVLTREEPROJECT_TABLECACHE_H
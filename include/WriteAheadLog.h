@@ -0,0 +1,208 @@
+//
+// A write-ahead log making the memtable writes durable
+//
+
+#ifndef AVLTREEPROJECT_WRITEAHEADLOG_H
+#define AVLTREEPROJECT_WRITEAHEADLOG_H
+
+#include <array>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+/**
+ * When the records appended to the log are forced to disk
+ */
+enum class WALSyncMode {
+    // every put waits until its record is synced; concurrent puts share one
+    // fdatasync (group commit)
+    ALWAYS,
+    // a background thread syncs the log every walSyncIntervalMs
+    PERIODIC,
+    // the log is written in large chunks and puts never wait for a sync,
+    // leaving it to the OS to reach the disk; only sync() and close() force it
+    NONE
+};
+
+/**
+ * A log of every KV-pair put into the memtables. The log is split into
+ * segments, one per memtable: a segment is started whenever the memtable is
+ * swapped, and deleted once that memtable has been saved as an SST.
+ *
+ * A record is the key, the value and a checksum of both, so a torn record at
+ * the end of a segment is detected and dropped when the log is replayed.
+ */
+class WriteAheadLog {
+private:
+    string myDbName;
+
+    WALSyncMode mySyncMode;
+
+    int mySyncIntervalMs;
+
+    /**
+     * Guards every member below
+     */
+    mutex myMutex;
+
+    /**
+     * Signalled whenever a write of the pending records finishes
+     */
+    condition_variable myCondition;
+
+    /**
+     * The file descriptor of the segment taking the appends
+     */
+    int myFd;
+
+    /**
+     * The id of the segment taking the appends
+     */
+    uint64_t mySegmentId;
+
+    /**
+     * The number of records in the segment taking the appends
+     */
+    uint64_t mySegmentRecords;
+
+    /**
+     * Segments of the memtables waiting to be saved, from oldest to newest
+     */
+    deque<uint64_t> myClosedSegments;
+
+    /**
+     * Segments left by the previous run of the store, from oldest to newest
+     */
+    vector<uint64_t> myRecoveredSegments;
+
+    /**
+     * Records appended but not yet written to the segment
+     */
+    vector<char> myPending;
+
+    /**
+     * The sequence number of the last appended, written and synced record
+     */
+    uint64_t myAppendedSeq;
+    uint64_t myWrittenSeq;
+    uint64_t myDurableSeq;
+
+    /**
+     * Whether a thread is writing the pending records outside the mutex.
+     * Only that thread may touch myFd.
+     */
+    bool myIsWriting;
+
+    /**
+     * Whether a write or sync of the log has failed
+     */
+    bool myHasFailed;
+
+    bool myIsStopping;
+
+    /**
+     * The background thread of the periodic sync mode
+     */
+    thread mySyncThread;
+
+    /**
+     * generate the path of the segment with the given id
+     */
+    string segmentPath(uint64_t theSegmentId);
+
+    /**
+     * create the segment with the given id and make it take the appends
+     * @return whether the segment is created
+     */
+    bool openSegment(uint64_t theSegmentId);
+
+    /**
+     * Writes every pending record to the segment, syncing it when asked.
+     * The lock on myMutex is released during the I/O, so the records
+     * appended meanwhile form the next group.
+     */
+    void writePending(unique_lock<mutex> &theLock, bool theIsSyncing);
+
+    /**
+     * The loop of the periodic sync thread
+     */
+    void syncPeriodically();
+
+public:
+    /**
+     * Opens the log under the database directory. Segments left by a
+     * previous run are kept for recover().
+     */
+    WriteAheadLog(string theDbName, WALSyncMode theSyncMode,
+                  int theSyncIntervalMs);
+
+    // Syncs the log and stops the sync thread
+    ~WriteAheadLog();
+
+    /**
+     * Appends a KV-pair to the segment taking the appends
+     * @return the sequence number of the record, to be passed to commit()
+     */
+    uint64_t append(int theKey, int theValue);
+
+    /**
+     * Appends a batch of KV-pairs under a single lock
+     * @return the sequence number of the last record
+     */
+    uint64_t append(const array<int, 2> *theKVPairs, size_t theCount);
+
+    /**
+     * Waits until the given record is as durable as the sync mode requires
+     * @return whether the log is healthy
+     */
+    bool commit(uint64_t theSeq);
+
+    /**
+     * Writes and syncs every appended record
+     * @return whether the log is healthy
+     */
+    bool sync();
+
+    /**
+     * Closes the segment taking the appends, which now belongs to the
+     * memtable being swapped out, and starts a new one
+     * @return whether the new segment is created
+     */
+    bool roll();
+
+    /**
+     * Deletes the segment of the oldest memtable waiting to be saved, once
+     * that memtable was persisted as an SST
+     */
+    void releaseOldestSegment();
+
+    /**
+     * Reads the KV-pairs of the segments left by the previous run, in the
+     * order they were put. Each segment stops at its first torn record.
+     * The segments are memory-mapped and their checksums validated by
+     * several threads.
+     * @param theNumBytes set to the size of the segments read
+     */
+    vector<array<int, 2>> recover(size_t &theNumBytes);
+
+    /**
+     * Deletes the segments left by the previous run, once their KV-pairs are
+     * durable again
+     */
+    void removeRecoveredSegments();
+
+    /**
+     * Syncs the log, stops the sync thread and deletes the segment taking
+     * the appends if it is empty
+     * @return whether the log is healthy
+     */
+    bool close();
+};
+
+#endif  // AVLTREEPROJECT_WRITEAHEADLOG_H
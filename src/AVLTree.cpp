@@ -3,12 +3,15 @@
 using namespace std;
 
 Node::Node(int key, int value)
-        : key(key), value(value), left(nullptr), right(nullptr), height(1) {}
+        : key(key), value(value), left(AVLTree::NIL), right(AVLTree::NIL), height(1) {}
 
-AVLTree::AVLTree(int capacity) : root(nullptr), capacity(capacity), size(0) {}
+AVLTree::AVLTree(int capacity) : root(NIL), capacity(capacity), size(0) {
+    // reserve the arena up front so that inserts never allocate
+    nodes.reserve(capacity);
+}
 
 string AVLTree::inOrderString() {
-    vector <array<int, 2>> scanResult = scan(this->root);
+    vector <array<int, 2>> scanResult = scan();
 
     string result;
     for (auto pair: scanResult){
@@ -18,171 +21,239 @@ string AVLTree::inOrderString() {
     return result;
 }
 
-int AVLTree::getValue(int key) { return getValueNode(this->root, key); }
-
-int AVLTree::getValueNode(Node *node, int key) {
-    if (node == nullptr) {
+int AVLTree::getValue(int key) {
+    optional<int> value = tryGet(key);
+    if (!value) {
         throw std::runtime_error("Key not found");
     }
-    if (key == node->key) {
-        return node->value;
-    } else if (key < node->key) {
-        return getValueNode(node->left, key);
-    } else {
-        return getValueNode(node->right, key);
+    return *value;
+}
+
+optional<int> AVLTree::tryGet(int key) { return tryGetNode(this->root, key); }
+
+optional<int> AVLTree::tryGetNode(uint32_t node, int key) {
+    while (node != NIL) {
+        const Node &curr = nodes[node];
+        if (key == curr.key) {
+            return curr.value;
+        }
+        node = key < curr.key ? curr.left : curr.right;
     }
+    return nullopt;
 }
 
 string AVLTree::preOrderString() { return preOrderNodeString(this->root); }
 
-string AVLTree::preOrderNodeString(Node *node) {
-    if (node == nullptr) {
+string AVLTree::preOrderNodeString(uint32_t node) {
+    if (node == NIL) {
         return "";
     }
 
-    string result = to_string(node->key) + " ";
-    result += preOrderNodeString(node->left);
-    result += preOrderNodeString(node->right);
+    string result = to_string(nodes[node].key) + " ";
+    result += preOrderNodeString(nodes[node].left);
+    result += preOrderNodeString(nodes[node].right);
     return result;
 }
 
-int AVLTree::getHeight(Node *node) { return node ? node->height : 0; }
+uint32_t AVLTree::allocateNode(int key, int val) {
+    // the arena is reserved to the capacity, so this never reallocates
+    nodes.emplace_back(key, val);
+    return nodes.size() - 1;
+}
+
+int AVLTree::getHeight(uint32_t node) { return node != NIL ? nodes[node].height : 0; }
 
-int AVLTree::getBalance(Node *node) {
-    if (node == nullptr) {
+int AVLTree::getBalance(uint32_t node) {
+    if (node == NIL) {
         return 0;
     }
-    return getHeight(node->left) - getHeight(node->right);
+    return getHeight(nodes[node].left) - getHeight(nodes[node].right);
 }
 
 vector <array<int, 2>> AVLTree::scan(int low, int high) {
-    return scan(root, low, high);
-}
+    vector <array<int, 2>> result;
+    Iterator it(*this);
 
-vector <array<int, 2>> AVLTree::scan(Node *node, int low, int high) {
-    if (node == nullptr) {
-        return {};
+    // stop as soon as the keys pass the upper bound
+    for (it.seek(low); it.valid() && it.key() <= high; it.next()) {
+        result.push_back({it.key(), it.value()});
     }
 
+    return result;
+}
+
+vector <array<int, 2>> AVLTree::scan() {
     vector <array<int, 2>> result;
-    if (node->key > low) {
-        // scan the left subtree
-        result = scan(node->left, low, high);
-    }
+    result.reserve(nodes.size());
+    Iterator it(*this);
 
-    if (high >= node->key && node->key >= low) {
-        // current node
-        result.push_back({node->key, node->value});
+    for (it.seekToFirst(); it.valid(); it.next()) {
+        result.push_back({it.key(), it.value()});
     }
 
-    if (node->key < high) {
-        // scan the right subtree
-        vector <array<int, 2>> right_result = scan(node->right, low, high);
-        result.insert(result.end(), right_result.begin(), right_result.end());
+    return result;
+}
+
+unique_ptr<KVIterator> AVLTree::newIterator() {
+    return make_unique<Iterator>(*this);
+}
+
+AVLTree::Iterator::Iterator(const AVLTree &theTree) : myTree(theTree) {
+    // an AVL tree is balanced, so the stack never grows beyond its height
+    if (myTree.root != NIL) {
+        myStack.reserve(myTree.nodes[myTree.root].height);
     }
+}
 
-    return result;
+void AVLTree::Iterator::pushLeftPath(uint32_t node) {
+    while (node != NIL) {
+        myStack.push_back(node);
+        node = myTree.nodes[node].left;
+    }
 }
 
-vector <array<int, 2>> AVLTree::scan() {
-    return scan(root);
+void AVLTree::Iterator::seekToFirst() {
+    myStack.clear();
+    pushLeftPath(myTree.root);
 }
 
-vector <array<int, 2>> AVLTree::scan(Node *node) {
-    if (node == nullptr) {
-        return {};
+void AVLTree::Iterator::seek(int theTarget) {
+    myStack.clear();
+
+    // keep the nodes where the search goes left, as they are visited later
+    uint32_t node = myTree.root;
+    while (node != NIL) {
+        const Node &curr = myTree.nodes[node];
+        if (curr.key >= theTarget) {
+            myStack.push_back(node);
+            node = curr.left;
+        } else {
+            node = curr.right;
+        }
     }
+}
 
-    vector <array<int, 2>> result;
-    // scan the left subtree
-    result = scan(node->left);
-    // current node
-    result.push_back({node->key, node->value});
-    // scan the right subtree
-    vector <array<int, 2>> right_result = scan(node->right);
-    result.insert(result.end(), right_result.begin(), right_result.end());
+bool AVLTree::Iterator::valid() { return !myStack.empty(); }
 
-    return result;
+void AVLTree::Iterator::next() {
+    uint32_t node = myStack.back();
+    myStack.pop_back();
+    pushLeftPath(myTree.nodes[node].right);
 }
 
+int AVLTree::Iterator::key() { return myTree.nodes[myStack.back()].key; }
+
+int AVLTree::Iterator::value() { return myTree.nodes[myStack.back()].value; }
+
 bool AVLTree::insert(int key, int value) {
-    if (this->size == this->capacity) {
+    if (!tryInsert(key, value)) {
         cout << "Cannot insert, tree is full!" << endl;
         return true;
     }
+    return isFull();
+}
+
+bool AVLTree::tryInsert(int key, int value) {
+    if (isFull()) {
+        return false;
+    }
 
-    Node *new_root = insertNode(this->root, key, value);
+    uint32_t new_root = insertNode(this->root, key, value);
     this->root = new_root;
     this->size++;
-    return this->size >= this->capacity;
+    return true;
 }
 
-Node *AVLTree::insertNode(Node *curr, int key, int val) {
-    if (curr == nullptr) return new Node(key, val);
+bool AVLTree::isFull() { return this->size >= this->capacity; }
+
+uint32_t AVLTree::insertNode(uint32_t curr, int key, int val) {
+    if (curr == NIL) return allocateNode(key, val);
 
-    if (key < curr->key) {
-        curr->left = insertNode(curr->left, key, val);
-    } else if (key > curr->key) {
-        curr->right = insertNode(curr->right, key, val);
+    if (key < nodes[curr].key) {
+        uint32_t left = insertNode(nodes[curr].left, key, val);
+        nodes[curr].left = left;
+    } else if (key > nodes[curr].key) {
+        uint32_t right = insertNode(nodes[curr].right, key, val);
+        nodes[curr].right = right;
     } else {
         cout << "Duplicate key!" << endl;
-        curr->value = val;
+        nodes[curr].value = val;
         return curr;
     }
 
-    curr->height = 1 + max(getHeight(curr->left), getHeight(curr->right));
+    Node &node = nodes[curr];
+    node.height = 1 + max(getHeight(node.left), getHeight(node.right));
 
     int balance = getBalance(curr);
-    if (balance > 1 && key < curr->left->key) {
+    if (balance > 1 && key < nodes[node.left].key) {
         return rightRotate(curr);
     }
-    if (balance > 1 && key > curr->left->key) {
-        curr->left = leftRotate(curr->left);
+    if (balance > 1 && key > nodes[node.left].key) {
+        node.left = leftRotate(node.left);
         return rightRotate(curr);
     }
-    if (balance < -1 && key > curr->right->key) {
+    if (balance < -1 && key > nodes[node.right].key) {
         return leftRotate(curr);
     }
-    if (balance < -1 && key < curr->right->key) {
-        curr->right = rightRotate(curr->right);
+    if (balance < -1 && key < nodes[node.right].key) {
+        node.right = rightRotate(node.right);
         return leftRotate(curr);
     }
 
     return curr;
 }
 
-Node *AVLTree::rightRotate(Node *node) {
-    Node *left = node->left;
-    Node *left_right = left->right;
+uint32_t AVLTree::rightRotate(uint32_t node) {
+    uint32_t left = nodes[node].left;
+    uint32_t left_right = nodes[left].right;
 
-    left->right = node;
-    node->left = left_right;
+    nodes[left].right = node;
+    nodes[node].left = left_right;
 
-    node->height = 1 + max(getHeight(node->left), getHeight(node->right));
-    left->height = 1 + max(getHeight(left->left), getHeight(left->right));
+    nodes[node].height = 1 + max(getHeight(nodes[node].left), getHeight(nodes[node].right));
+    nodes[left].height = 1 + max(getHeight(nodes[left].left), getHeight(nodes[left].right));
 
     return left;
 }
 
-Node *AVLTree::leftRotate(Node *node) {
-    Node *right = node->right;
-    Node *right_left = right->left;
+uint32_t AVLTree::leftRotate(uint32_t node) {
+    uint32_t right = nodes[node].right;
+    uint32_t right_left = nodes[right].left;
 
-    right->left = node;
-    node->right = right_left;
+    nodes[right].left = node;
+    nodes[node].right = right_left;
 
-    node->height = 1 + max(getHeight(node->left), getHeight(node->right));
-    right->height = 1 + max(getHeight(right->left), getHeight(right->right));
+    nodes[node].height = 1 + max(getHeight(nodes[node].left), getHeight(nodes[node].right));
+    nodes[right].height = 1 + max(getHeight(nodes[right].left), getHeight(nodes[right].right));
 
     return right;
 }
 
-AVLTree::~AVLTree() { deleteTree(root); }
+void AVLTree::bulkLoad(const array<int, 2> *kvPairs, size_t count) {
+    root = buildBalanced(kvPairs, 0, count);
+    size = (int) count;
+}
 
-void AVLTree::deleteTree(Node *node) {
-    if (node != nullptr) {
-        deleteTree(node->left);
-        deleteTree(node->right);
-        delete node;
-    }
-}
\ No newline at end of file
+uint32_t AVLTree::buildBalanced(const array<int, 2> *kvPairs, size_t begin, size_t end) {
+    if (begin >= end) return NIL;
+
+    // the middle pair is the root, so both halves differ by at most one node
+    size_t mid = begin + (end - begin) / 2;
+    uint32_t node = allocateNode(kvPairs[mid][0], kvPairs[mid][1]);
+    uint32_t left = buildBalanced(kvPairs, begin, mid);
+    uint32_t right = buildBalanced(kvPairs, mid + 1, end);
+
+    nodes[node].left = left;
+    nodes[node].right = right;
+    nodes[node].height = 1 + max(getHeight(left), getHeight(right));
+    return node;
+}
+
+void AVLTree::clear() {
+    // nodes are trivially destructible, so this only resets the arena
+    nodes.clear();
+    root = NIL;
+    size = 0;
+}
+
+bool AVLTree::isConcurrent() { return false; }
@@ -0,0 +1,57 @@
+#include "AdmissionFilter.h"
+
+#include <algorithm>
+
+unique_ptr<AdmissionFilter> AdmissionFilter::create(AdmissionPolicyType type, int sketchWidth) {
+    if (type == AdmissionPolicyType::TINY_LFU) {
+        return make_unique<TinyLFUFilter>(sketchWidth);
+    }
+    return nullptr;
+}
+
+TinyLFUFilter::TinyLFUFilter(int sketchWidth) : numSamples(0) {
+    width = 64;
+    while (width < (size_t)sketchWidth) {
+        width *= 2;
+    }
+    counters.resize(DEPTH * width, 0);
+    sampleSize = 10 * width;
+}
+
+size_t TinyLFUFilter::counterIdx(uint64_t hash, int row) {
+    // double hashing gives each row an independent-enough position
+    uint64_t step = (hash >> 32) | 1;
+    return row * width + ((hash + row * step) & (width - 1));
+}
+
+int TinyLFUFilter::estimate(PageId pageId) {
+    uint64_t hash = hashPageId(pageId);
+    int count = MAX_COUNT;
+    for (int row = 0; row < DEPTH; row++) {
+        count = min(count, (int)counters[counterIdx(hash, row)]);
+    }
+    return count;
+}
+
+void TinyLFUFilter::recordAccess(PageId pageId) {
+    uint64_t hash = hashPageId(pageId);
+    for (int row = 0; row < DEPTH; row++) {
+        uint8_t& counter = counters[counterIdx(hash, row)];
+        if (counter < MAX_COUNT) {
+            counter++;
+        }
+    }
+
+    // age the counters, so pages which were hot long ago can be replaced
+    numSamples++;
+    if (numSamples >= sampleSize) {
+        for (uint8_t& counter : counters) {
+            counter /= 2;
+        }
+        numSamples /= 2;
+    }
+}
+
+bool TinyLFUFilter::admit(PageId candidate, PageId victim) {
+    return estimate(candidate) > estimate(victim);
+}
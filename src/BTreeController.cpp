@@ -1,6 +1,7 @@
 #include "BTreeController.h"
 
 #include <fcntl.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
@@ -68,6 +69,10 @@ void BTreeController::createBTree(int sstIdx) {
 
     vector<array<int, 2>> sstData = mySSTController->readSST(sstIdx);
 
+    // the nodes of a B-tree built before are stale
+    mySSTController->getBufferPool().invalidateIndex(sstIdx);
+    mySSTController->getTableCache().evict(getBTreeFileName(sstIdx));
+
     // open B Tree file
     string btreeFilePath = getBTreeFileName(sstIdx);
 
@@ -216,85 +221,140 @@ int BTreeController::binarySearchNodeValues(vector<BTreeNodeValue> nodeValues,
     return nodeValues[l].childPage;
 }
 
-BTreeNode BTreeController::readBTreePage(int fd, int page) {
-    char buffer[bTreeNodeSize];  // size of 1 I/O
+BTreeNode BTreeController::readBTreePage(shared_ptr<OpenFile>& file, int sstIdx,
+                                         int page) {
+    if (mySSTController->isUsingMmapReads()) {
+        if (!file) {
+            string btreeFilePath = getBTreeFileName(sstIdx);
+            file = mySSTController->getTableCache().acquire(btreeFilePath);
+            if (!file) {
+                throw runtime_error("Error opening B-tree file for reading: " +
+                                    btreeFilePath);
+            }
+        }
+
+        // a lookup touches one node per level of the tree
+        size_t fileSize;
+        const char* mapping = file->map(MADV_RANDOM, fileSize);
+        size_t offset = (size_t)page * bTreeNodeSize;
+        if (mapping != nullptr && offset + sizeof(int) <= fileSize) {
+            int size;
+            memcpy(&size, mapping + offset, sizeof(int));
+            size_t maxSize = (fileSize - offset - sizeof(int)) / sizeof(array<int, 2>);
+            size = (int)std::min((size_t)std::min(std::max(size, 0), B), maxSize);
+
+            BTreeNode node;
+            node.size = size;
+            const char* values = mapping + offset + sizeof(int);
+            for (int i = 0; i < size; i++) {
+                array<int, 2> value;
+                memcpy(&value, values + i * sizeof(value), sizeof(value));
+                node.values.push_back(BTreeNodeValue(value[0], value[1]));
+            }
+            return node;
+        }
+        // otherwise read the node through the buffer pool
+    }
+
+    // a node value has the layout of a KV pair, so a node fits in a frame
+    BufferPool& bufferPool = mySSTController->getBufferPool();
+    PageId pageId = BufferPool::makeIndexPageId(sstIdx, page);
+    PageHandle nodeValues = bufferPool.getPage(pageId);
+
+    if (nodeValues.empty()) {
+        if (!file) {
+            string btreeFilePath = getBTreeFileName(sstIdx);
+            file = mySSTController->getTableCache().acquire(btreeFilePath);
+            if (!file) {
+                throw runtime_error("Error opening B-tree file for reading: " +
+                                    btreeFilePath);
+            }
+        }
+
+        char buffer[bTreeNodeSize];  // size of 1 I/O
+
+        memset(buffer, 0, sizeof(buffer));  // reset
+
+        // read the B-tree node into memory
+        ssize_t bytesRead =
+            pread(file->fd(), buffer, sizeof(buffer), page * bTreeNodeSize);
+        if (bytesRead <= 0) {
+            throw runtime_error("Error reading B-tree file");
+        }
 
-    memset(buffer, 0, sizeof(buffer));  // reset
+        int size;
+        memcpy(&size, buffer, sizeof(int));
+        size = std::min(std::max(size, 0), B);
 
-    // read the first B-tree node (root) into memory
-    ssize_t bytesRead = pread(fd, buffer, sizeof(buffer), page * bTreeNodeSize);
-    if (bytesRead <= 0) {
-        close(fd);
-        throw runtime_error("Error reading B-tree file");
+        // the node values follow the size
+        KVSpan values(reinterpret_cast<const array<int, 2>*>(buffer + sizeof(int)),
+                      size);
+        nodeValues = bufferPool.putPage(pageId, values, CacheHint::NORMAL,
+                                        PagePriority::HIGH);
     }
 
-    BTreeNode root;
-    memcpy(&root.size, buffer, sizeof(int));
-    int offset = sizeof(int);  // start from after size is read
-
-    // read the node values from the buffer
-    for (int i = 0; i < root.size; i++) {
-        int value;
-        int childPage;
-        memcpy(&value, buffer + offset, sizeof(int));
-        memcpy(&childPage, buffer + offset + sizeof(int), sizeof(int));
-        // cout << "value: " << value << endl;
-        // cout << "childPage: " << childPage << endl;
-        root.values.push_back(BTreeNodeValue(value, childPage));
-        offset += sizeof(BTreeNodeValue);
+    BTreeNode node;
+    node.size = nodeValues.size();
+    for (const array<int, 2>& value : nodeValues) {
+        node.values.push_back(BTreeNodeValue(value[0], value[1]));
     }
 
-    return root;
+    return node;
 }
 
-pair<bool, int> BTreeController::searchBTreeNodes(int key, int sstIdx) {
-    // construct the path for the B-tree file for this SST file
-    string btreeFilePath = getBTreeFileName(sstIdx);
+optional<int> BTreeController::searchBTreeNodes(int key, int sstIdx) {
+    // the B-tree file is acquired by the first node missing from the buffer
+    // pool, so a lookup through cached nodes does no I/O on it
+    shared_ptr<OpenFile> file;
 
-    // open the B-tree file for reading
-    int fd = open(btreeFilePath.c_str(), O_RDONLY);
-    if (fd < 0) {
-        throw runtime_error("Error opening B-tree file for reading: " +
-                            btreeFilePath);
-    }
-
-    BTreeNode root = readBTreePage(fd, 0);
+    BTreeNode root = readBTreePage(file, sstIdx, 0);
 
     BTreeNode curr = root;
     // traverse the B-tree
     while (!isNodeLeaf(curr)) {
         if (curr.values.back().key < key) {
             // the key not found
-            return {false, 0};
+            return nullopt;
         }
 
         // binary search to search for key position
         int childPage = binarySearchNodeValues(curr.values, key);
         childPage = childPage * -1 - 1;  // convert internal node page key
 
-        curr = readBTreePage(fd, childPage);
+        curr = readBTreePage(file, sstIdx, childPage);
+    }
+
+    // now on a leaf node, whose largest key may still be below the key
+    if (curr.values.empty() || curr.values.back().key < key) {
+        return nullopt;
     }
 
-    // now on a leaf node
     // binary search to search for key position
     int sstPage = binarySearchNodeValues(
         curr.values, key);  // leaf node child page points to sst page
 
     // finally we read the page in the sst and search it for the key
-    auto kvPairs = mySSTController->readSSTPage(sstIdx, sstPage);
+    PageHandle kvPairs = mySSTController->readSSTPage(sstIdx, sstPage);
 
-    int resIdx = mySSTController->searchSST(kvPairs, key);
+    int resIdx = mySSTController->searchSST(kvPairs.kvPairs(), key);
     if (resIdx != -1) {
-        return {true, kvPairs[resIdx][1]};
+        return kvPairs[resIdx][1];
     }
 
-    close(fd);
-
     // the key not found
-    return {false, 0};
+    return nullopt;
 }
 
 pair<bool, int> BTreeController::get(int key) {
+    optional<int> value = tryGet(key);
+    if (!value) {
+        // not found
+        return {false, 0};
+    }
+    return {true, *value};
+}
+
+optional<int> BTreeController::tryGet(int key) {
     if (!isBTreeCreated()) {
         throw runtime_error(
             "B-tree is not created. Create it first to use B-tree search.");
@@ -304,12 +364,12 @@ pair<bool, int> BTreeController::get(int key) {
 
     // search through the B-trees of each SST file (from newest to oldest)
     for (int i = totalSSTs; i > 0; i--) {
-        pair<bool, int> result = searchBTreeNodes(key, i);
-        if (result.first) {
+        optional<int> result = searchBTreeNodes(key, i);
+        if (result) {
             return result;
         }
     }
 
     // not found
-    return {false, 0};
+    return nullopt;
 }
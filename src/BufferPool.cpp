@@ -1,151 +1,723 @@
 #include "BufferPool.h"
 
+#include <sys/mman.h>
+
+#include <algorithm>
+#include <cstring>
+#include <new>
+
 #include "Constants.h"
-#include "xxHash32.h"
 
-int SEED = 123;
+// the default number of shards keeps at least this many pages per shard
+const int MIN_PAGES_PER_SHARD = 64;
+const int MAX_DEFAULT_SHARDS = 16;
+
+const size_t HUGE_PAGE_SIZE = 2 << 20;
+
+// the level in the ids of index pages, above any level of an LSM tree
+const int INDEX_PAGE_LEVEL = 0xFFFF;
+
+// spreads the capacity of the pool as evenly as possible over the shards
+static int shardCapacity(int capacity, int numShards, int shardIdx) {
+    return capacity / numShards + (shardIdx < capacity % numShards ? 1 : 0);
+}
+
+// the number of frames of a shard which high-priority pages may take
+static int highPriorityCapacityOf(int capacity, double ratio) {
+    if (ratio <= 0 || capacity <= 0) {
+        return 0;
+    }
+    return min(capacity, max(1, (int)(capacity * ratio)));
+}
 
-BufferFrame::BufferFrame(string pageId, vector<array<int, 2>> kvPairs)
-    : pageId(pageId),
-      kvPairs(kvPairs),
-      isDirty(false),
-      next(nullptr),
-      refBit(true) {};
+// maps anonymous memory, or returns nullptr if the mapping fails
+static char* mapAnonymous(size_t numBytes, int extraFlags) {
+    void* memory = mmap(nullptr, numBytes, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS | extraFlags, -1, 0);
+    return memory == MAP_FAILED ? nullptr : static_cast<char*>(memory);
+}
 
-BufferPool::BufferPool(int capacity)
-    : capacity(capacity), numPages(0), clockHand(0) {
-    bufferFrames.resize(capacity, nullptr);  // Init with nullptrs
+static shared_ptr<char> ownMapping(char* memory, size_t numBytes) {
+    return shared_ptr<char>(memory, [numBytes](char* mapped) { munmap(mapped, numBytes); });
 }
 
-BufferPool::~BufferPool() {
-    for (auto& head : bufferFrames) {
-        while (head != nullptr) {
-            BufferFrame* temp = head;
-            head = head->next;
-            delete temp;  // free memory for each linked list node
+FrameMemory FrameMemory::map(size_t numBytes, bool useHugePages) {
+    if (numBytes == 0) {
+        return FrameMemory();
+    }
+
+    // a region smaller than a huge page could not use one
+    if (useHugePages && numBytes >= HUGE_PAGE_SIZE) {
+        size_t hugeBytes = (numBytes + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+#ifdef MAP_HUGETLB
+        // explicit huge pages only exist when the system reserved them
+        if (char* memory = mapAnonymous(hugeBytes, MAP_HUGETLB)) {
+            return {ownMapping(memory, hugeBytes), true};
         }
+#endif
+#ifdef MADV_HUGEPAGE
+        // transparent huge pages need a region aligned to a huge page, so
+        // map one huge page more and trim both ends
+        if (char* memory = mapAnonymous(hugeBytes + HUGE_PAGE_SIZE, 0)) {
+            uintptr_t address = reinterpret_cast<uintptr_t>(memory);
+            size_t headBytes = (HUGE_PAGE_SIZE - address % HUGE_PAGE_SIZE) % HUGE_PAGE_SIZE;
+            char* aligned = memory + headBytes;
+            if (headBytes > 0) {
+                munmap(memory, headBytes);
+            }
+            munmap(aligned + hugeBytes, HUGE_PAGE_SIZE - headBytes);
+
+            bool isAdvised = madvise(aligned, hugeBytes, MADV_HUGEPAGE) == 0;
+            return {ownMapping(aligned, hugeBytes), isAdvised};
+        }
+#endif
     }
+
+    char* memory = mapAnonymous(numBytes, 0);
+    if (memory == nullptr) {
+        throw bad_alloc();
+    }
+    return {ownMapping(memory, numBytes), false};
 }
 
-string BufferPool::makePageId(int sstIdx, int pageNum) {
-    return to_string(sstIdx) + "-" + to_string(pageNum);
+FrameMemory FrameMemory::slice(size_t offset) const {
+    return {shared_ptr<char>(memory, memory.get() + offset), isHugePageBacked};
 }
 
-string BufferPool::makeLeveledPageId(int sstLevel, int sstIdx, int pageNum) {
-    return to_string(sstLevel) + "-" + to_string(sstIdx) + "-" + to_string(pageNum);
+PageHandle::PageHandle() : myShard(nullptr), myFrameIdx(-1) {}
+
+PageHandle::PageHandle(BufferPoolShard* theShard, int theFrameIdx, KVSpan theKVPairs)
+    : myShard(theShard), myFrameIdx(theFrameIdx), myKVPairs(theKVPairs) {}
+
+PageHandle::PageHandle(vector<array<int, 2>> theKVPairs)
+    : myShard(nullptr),
+      myFrameIdx(-1),
+      myOwnedKVPairs(std::move(theKVPairs)) {
+    myKVPairs = KVSpan(myOwnedKVPairs);
 }
 
-int BufferPool::hashPageIdToIndex(string pageId) {
-    return XXHash32::hash(pageId.c_str(), pageId.size(), SEED) % capacity;
+PageHandle::PageHandle(KVSpan theKVPairs, shared_ptr<const void> theOwner)
+    : myShard(nullptr), myFrameIdx(-1), myKVPairs(theKVPairs), myOwner(std::move(theOwner)) {}
+
+PageHandle::PageHandle(PageHandle&& theOther) noexcept
+    : myShard(theOther.myShard),
+      myFrameIdx(theOther.myFrameIdx),
+      myOwnedKVPairs(std::move(theOther.myOwnedKVPairs)),
+      myOwner(std::move(theOther.myOwner)) {
+    // moving the vector keeps its buffer, so the span stays valid
+    myKVPairs = theOther.myKVPairs;
+    theOther.myShard = nullptr;
+    theOther.myKVPairs = KVSpan();
 }
 
-int BufferPool::findPage(int sstIdx, int pageNum) {
-    string pageId = makePageId(sstIdx, pageNum);
-    int idx = hashPageIdToIndex(pageId);
+PageHandle& PageHandle::operator=(PageHandle&& theOther) noexcept {
+    if (this != &theOther) {
+        release();
+        myShard = theOther.myShard;
+        myFrameIdx = theOther.myFrameIdx;
+        myOwnedKVPairs = std::move(theOther.myOwnedKVPairs);
+        myOwner = std::move(theOther.myOwner);
+        myKVPairs = theOther.myKVPairs;
+        theOther.myShard = nullptr;
+        theOther.myKVPairs = KVSpan();
+    }
+    return *this;
+}
 
-    BufferFrame* curr = bufferFrames[idx];
-    while (curr != nullptr) {
-        if (curr->pageId == pageId) return idx;
-        curr = curr->next;
+PageHandle::~PageHandle() { release(); }
+
+void PageHandle::release() {
+    if (myShard != nullptr) {
+        myShard->unpin(myFrameIdx);
+        myShard = nullptr;
     }
-    return -1;  // page not found
-};
+    myKVPairs = KVSpan();
+    myOwnedKVPairs.clear();
+    myOwner.reset();
+}
 
-vector<array<int, 2>> BufferPool::getPage(string pageId) {
-    // cout << sstIdx << "," << pageNum << endl;
-    int idx = hashPageIdToIndex(pageId);
+BufferPoolShard::BufferPoolShard(int capacity, EvictionPolicyType evictionPolicyType,
+                                 unique_ptr<AdmissionFilter> admissionFilter,
+                                 double highPriorityRatio, bool useHugePages,
+                                 FrameMemory frameMemory)
+    : capacity(capacity),
+      numPages(0),
+      highPriorityRatio(highPriorityRatio),
+      highPriorityCapacity(highPriorityCapacityOf(capacity, highPriorityRatio)),
+      numHighPriorityPages(0),
+      useHugePages(useHugePages),
+      evictionPolicies{EvictionPolicy::create(evictionPolicyType, capacity),
+                       EvictionPolicy::create(evictionPolicyType, capacity)},
+      admissionFilter(std::move(admissionFilter)),
+      numHits(0),
+      numMisses(0),
+      numEvictions(0),
+      numRejections(0),
+      numProbes(0),
+      numSweepSteps(0) {
+    if (capacity > 0) {
+        addFrames(capacity, std::move(frameMemory));
+    }
+    // hand out the frames in order
+    for (int frameIdx = capacity - 1; frameIdx >= 0; frameIdx--) {
+        freeFrames.push_back(frameIdx);
+    }
+}
+
+void BufferPoolShard::addFrames(int numFrames, FrameMemory memory) {
+    // a page-aligned block for the frames, so pages can be read into and
+    // searched in place
+    if (memory.memory == nullptr) {
+        memory = FrameMemory::map((size_t)numFrames * PAGE_SIZE, useHugePages);
+    }
+
+    int firstFrame = bufferFrames.size();
+    char* frames = memory.memory.get();
+    frameChunks.push_back({firstFrame, numFrames, std::move(memory)});
+    for (int i = 0; i < numFrames; i++) {
+        bufferFrames.push_back({0, 0, 0, false, false, PagePriority::NORMAL});
+        frameAddresses.push_back(frames + (size_t)i * PAGE_SIZE);
+    }
+}
 
-    BufferFrame* curr = bufferFrames[idx];
-    while (curr != nullptr) {
-        if (curr->pageId == pageId) {
-            curr->refBit = true;  // mark as recently used
-            return curr->kvPairs;
+void BufferPoolShard::releaseRetiredChunks() {
+    while (!frameChunks.empty() && frameChunks.back().firstFrame >= capacity) {
+        FrameChunk& chunk = frameChunks.back();
+        for (int frameIdx = chunk.firstFrame; frameIdx < chunk.firstFrame + chunk.numFrames;
+             frameIdx++) {
+            if (bufferFrames[frameIdx].pinCount > 0) {
+                return;  // freed by the last unpin instead
+            }
         }
-        curr = curr->next;
+
+        bufferFrames.resize(chunk.firstFrame);
+        frameAddresses.resize(chunk.firstFrame);
+        frameChunks.pop_back();
     }
-    // cout << "page not found" << endl;
-    return {};
 }
 
-void BufferPool::putPage(string pageId, vector<array<int, 2>> kvPairs) {
-    if (numPages == capacity) {
-        evictPage();
+array<int, 2>* BufferPoolShard::frameData(int frameIdx) {
+    return reinterpret_cast<array<int, 2>*>(frameAddresses[frameIdx]);
+}
+
+PageHandle BufferPoolShard::pin(int frameIdx) {
+    BufferFrame& frame = bufferFrames[frameIdx];
+    frame.pinCount++;
+    return PageHandle(this, frameIdx, KVSpan(frameData(frameIdx), frame.numKVPairs));
+}
+
+void BufferPoolShard::unpin(int frameIdx) {
+    lock_guard<mutex> lock(shardMutex);
+    BufferFrame& frame = bufferFrames[frameIdx];
+    frame.pinCount--;
+    if (frame.pinCount == 0 && !frame.isCached) {
+        releaseFrame(frameIdx);
     }
+}
 
-    // insert page
-    int idx = hashPageIdToIndex(pageId);
-    BufferFrame* curr = bufferFrames[idx];
-    BufferFrame* prev = nullptr;
+int BufferPoolShard::findPage(PageId pageId) {
+    lock_guard<mutex> lock(shardMutex);
+    return pageTable.find(pageId);  // -1 if page not found
+};
 
-    while (curr != nullptr) {
-        if (curr->pageId == pageId) return;  // page already exists
-        prev = curr;
-        curr = curr->next;
+PageHandle BufferPoolShard::getPage(PageId pageId) {
+    lock_guard<mutex> lock(shardMutex);
+    if (admissionFilter) {
+        admissionFilter->recordAccess(pageId);
     }
 
-    BufferFrame* newFrame = new BufferFrame(pageId, kvPairs);
-    if (prev == nullptr) {
-        // if the linked list is empty, insert as the first element
-        bufferFrames[idx] = newFrame;
-    } else {
-        prev->next = newFrame;
+    uint64_t probes = 0;
+    int frameIdx = pageTable.find(pageId, &probes);
+    numProbes.fetch_add(probes, memory_order_relaxed);
+
+    array<uint64_t, 2>& sstCounter = sstCounterOf(pageId);
+    if (frameIdx == -1) {
+        numMisses.fetch_add(1, memory_order_relaxed);
+        sstCounter[1]++;
+        return PageHandle();
     }
-    numPages++;
+    numHits.fetch_add(1, memory_order_relaxed);
+    sstCounter[0]++;
+    policyOf(frameIdx).onAccess(frameIdx);
+    return pin(frameIdx);
 }
 
-void BufferPool::updatePage(int sstIdx, int pageNum,
-                            vector<array<int, 2>> kvPairs) {
-    string pageId = makePageId(sstIdx, pageNum);
-    int idx = hashPageIdToIndex(pageId);
+// reads a page which is not cached into an aligned buffer on the stack, which
+// needs no allocation, and returns a handle owning a copy of it
+static PageHandle readUncachedPage(const PageReader& reader) {
+    alignas(PAGE_SIZE) char buffer[PAGE_SIZE];
+    ssize_t numBytes = reader(buffer);
+    if (numBytes <= 0) {
+        return PageHandle();
+    }
+    auto* kvPairs = reinterpret_cast<const array<int, 2>*>(buffer);
+    return PageHandle(vector<array<int, 2>>(kvPairs, kvPairs + numBytes / KVPAIR_SIZE));
+}
+
+PageHandle BufferPoolShard::putPage(PageId pageId, KVSpan kvPairs, PagePriority priority) {
+    lock_guard<mutex> lock(shardMutex);
+    int frameIdx = pageTable.find(pageId);
+    if (frameIdx != -1) {
+        // page already exists
+        policyOf(frameIdx).onAccess(frameIdx);
+        return pin(frameIdx);
+    }
+
+    frameIdx = takeFrame(pageId, priority);
+    if (frameIdx == -1) {
+        // every frame is pinned or the page is colder than the victim, so
+        // hand out the page without caching it
+        return PageHandle(vector<array<int, 2>>(kvPairs.begin(), kvPairs.end()));
+    }
 
-    BufferFrame* curr = bufferFrames[idx];
-    while (curr != nullptr) {
-        if (curr->pageId == pageId) {
-            curr->kvPairs = kvPairs;
-            curr->isDirty = true;
-            return;
+    size_t numKVPairs = min(kvPairs.size(), (size_t)(PAGE_SIZE / KVPAIR_SIZE));
+    memcpy(frameData(frameIdx), kvPairs.data(), numKVPairs * KVPAIR_SIZE);
+    insertPage(frameIdx, pageId, numKVPairs, priority);
+
+    return pin(frameIdx);
+}
+
+PageHandle BufferPoolShard::loadPage(PageId pageId, const PageReader& reader,
+                                     PagePriority priority) {
+    unique_lock<mutex> lock(shardMutex);
+    int frameIdx = pageTable.find(pageId);
+    if (frameIdx != -1) {
+        // page already exists
+        policyOf(frameIdx).onAccess(frameIdx);
+        return pin(frameIdx);
+    }
+
+    frameIdx = takeFrame(pageId, priority);
+    if (frameIdx == -1) {
+        // every frame is pinned or the page is colder than the victim
+        lock.unlock();
+        return readUncachedPage(reader);
+    }
+
+    // the pin keeps the frame, and its chunk, from being reused or released
+    // while the page is read into it without the lock
+    bufferFrames[frameIdx].pinCount = 1;
+    char* data = frameAddresses[frameIdx];
+    lock.unlock();
+
+    ssize_t numBytes = reader(data);
+
+    lock.lock();
+    bufferFrames[frameIdx].pinCount = 0;
+    int cachedFrameIdx = pageTable.find(pageId);
+    if (numBytes <= 0 || cachedFrameIdx != -1 || frameIdx >= capacity) {
+        // no such page, or it was cached by a concurrent reader, or the frame
+        // was retired by a resize meanwhile
+        vector<array<int, 2>> kvPairs;
+        if (numBytes > 0 && cachedFrameIdx == -1) {
+            kvPairs.assign(frameData(frameIdx), frameData(frameIdx) + numBytes / KVPAIR_SIZE);
         }
-        curr = curr->next;
+        releaseFrame(frameIdx);
+        if (cachedFrameIdx != -1) {
+            policyOf(cachedFrameIdx).onAccess(cachedFrameIdx);
+            return pin(cachedFrameIdx);
+        }
+        return kvPairs.empty() ? PageHandle() : PageHandle(std::move(kvPairs));
     }
+
+    size_t numKVPairs = min((size_t)numBytes / KVPAIR_SIZE, (size_t)(PAGE_SIZE / KVPAIR_SIZE));
+    insertPage(frameIdx, pageId, numKVPairs, priority);
+    return pin(frameIdx);
 }
 
-void BufferPool::evictPage() {
-    // cout << "Begin eviction" << endl;
-    while (true) {
-        BufferFrame* frame = bufferFrames[clockHand];
+int BufferPoolShard::takeFrame(PageId pageId, PagePriority priority) {
+    if (!freeFrames.empty()) {
+        int frameIdx = freeFrames.back();
+        freeFrames.pop_back();
+        return frameIdx;
+    }
+    if (capacity > 0) {
+        return evictPage(pageId, priority);
+    }
+    return -1;
+}
 
-        if (frame == nullptr) {
-            clockHand = (clockHand + 1) % capacity;
+void BufferPoolShard::releaseFrame(int frameIdx) {
+    if (bufferFrames[frameIdx].pinCount > 0) {
+        return;
+    }
+    if (frameIdx < capacity) {
+        freeFrames.push_back(frameIdx);
+    } else {
+        releaseRetiredChunks();
+    }
+}
+
+void BufferPoolShard::insertPage(int frameIdx, PageId pageId, size_t numKVPairs,
+                                 PagePriority priority) {
+    BufferFrame& frame = bufferFrames[frameIdx];
+    frame.pageId = pageId;
+    frame.numKVPairs = numKVPairs;
+    frame.pinCount = 0;
+    frame.isDirty = false;
+    frame.isCached = true;
+    frame.priority = priority;
+    numPages++;
+    if (priority == PagePriority::HIGH) {
+        numHighPriorityPages++;
+    }
+
+    pageTable.insert(pageId, frameIdx);
+    policyOf(frameIdx).onInsert(frameIdx, pageId);
+}
+
+void BufferPoolShard::updatePage(PageId pageId, const vector<array<int, 2>>& kvPairs) {
+    lock_guard<mutex> lock(shardMutex);
+    int frameIdx = pageTable.find(pageId);
+    if (frameIdx == -1) {
+        return;
+    }
+
+    BufferFrame& frame = bufferFrames[frameIdx];
+    frame.numKVPairs = min(kvPairs.size(), (size_t)(PAGE_SIZE / KVPAIR_SIZE));
+    memcpy(frameData(frameIdx), kvPairs.data(), frame.numKVPairs * KVPAIR_SIZE);
+    frame.isDirty = true;
+}
+
+EvictionPolicy& BufferPoolShard::policyOf(int frameIdx) {
+    return *evictionPolicies[(int)bufferFrames[frameIdx].priority];
+}
+
+void BufferPoolShard::dropPage(int frameIdx) {
+    BufferFrame& frame = bufferFrames[frameIdx];
+    pageTable.erase(frame.pageId);
+    policyOf(frameIdx).onRemove(frameIdx);
+    frame.isCached = false;
+    numPages--;
+    if (frame.priority == PagePriority::HIGH) {
+        numHighPriorityPages--;
+    }
+}
+
+int BufferPoolShard::invalidate(PageId prefix) {
+    lock_guard<mutex> lock(shardMutex);
+    int numDropped = 0;
+    for (int frameIdx = 0; frameIdx < (int)bufferFrames.size(); frameIdx++) {
+        BufferFrame& frame = bufferFrames[frameIdx];
+        if (!frame.isCached || (frame.pageId >> 32) != prefix) {
             continue;
         }
 
-        // if the reference bit is 0, evict the page
-        if (!frame->refBit) {
-            // cout << "Evicted page" << endl;
+        dropPage(frameIdx);
+        // a pinned frame is freed by its last unpin instead
+        if (frame.pinCount == 0) {
+            freeFrames.push_back(frameIdx);
+        }
+        numDropped++;
+    }
+    return numDropped;
+}
 
-            // TODO: if the page is dirty, write it back to storage
-            if (frame->isDirty) {
-                cout << "Writing dirty page not implemented!" << endl;
-            }
+int BufferPoolShard::evictPage(PageId candidate, PagePriority priority) {
+    // a data page only displaces data pages, while a high-priority page
+    // displaces them until high-priority pages fill their region, and then
+    // replaces another high-priority page
+    bool isHighRegionFull = numHighPriorityPages >= highPriorityCapacity;
+    PagePriority victimTier =
+        priority == PagePriority::HIGH && isHighRegionFull ? PagePriority::HIGH : PagePriority::NORMAL;
+
+    uint64_t sweepSteps = 0;
+    int frameIdx = evictionPolicies[(int)victimTier]->pickVictim(bufferFrames, sweepSteps);
+    if (frameIdx == -1 && priority == PagePriority::HIGH && victimTier == PagePriority::NORMAL) {
+        frameIdx = evictionPolicies[(int)PagePriority::HIGH]->pickVictim(bufferFrames, sweepSteps);
+    }
+    numSweepSteps.fetch_add(sweepSteps, memory_order_relaxed);
+    if (frameIdx == -1) {
+        return -1;
+    }
+
+    // a page read once must not displace a page read often. Index pages are
+    // read by every lookup, so they are always admitted.
+    BufferFrame& frame = bufferFrames[frameIdx];
+    if (priority == PagePriority::NORMAL && admissionFilter &&
+        !admissionFilter->admit(candidate, frame.pageId)) {
+        numRejections.fetch_add(1, memory_order_relaxed);
+        return -1;
+    }
+    policyOf(frameIdx).onEvict(frameIdx);
+    numEvictions.fetch_add(1, memory_order_relaxed);
+
+    // TODO: if the page is dirty, write it back to storage
+    if (frame.isDirty) {
+        cout << "Writing dirty page not implemented!" << endl;
+    }
+
+    // remove the page from the page table
+    pageTable.erase(frame.pageId);
+    frame.isCached = false;
+    numPages--;
+    if (frame.priority == PagePriority::HIGH) {
+        numHighPriorityPages--;
+    }
+    return frameIdx;
+}
+
+void BufferPoolShard::resize(int newCapacity) {
+    lock_guard<mutex> lock(shardMutex);
+    int oldCapacity = capacity;
+    capacity = newCapacity;
+    highPriorityCapacity = highPriorityCapacityOf(newCapacity, highPriorityRatio);
 
-            // remove the page from buffer pool chain
-            if (frame->next != nullptr) {
-                bufferFrames[clockHand] = frame->next;
-            } else {
-                bufferFrames[clockHand] = nullptr;
+    if (newCapacity < oldCapacity) {
+        // evict the pages past the new capacity, and forget their frames
+        freeFrames.erase(remove_if(freeFrames.begin(), freeFrames.end(),
+                                   [newCapacity](int frameIdx) { return frameIdx >= newCapacity; }),
+                         freeFrames.end());
+        for (int frameIdx = newCapacity; frameIdx < (int)bufferFrames.size(); frameIdx++) {
+            if (bufferFrames[frameIdx].isCached) {
+                dropPage(frameIdx);
+                numEvictions.fetch_add(1, memory_order_relaxed);
             }
-            delete frame;
-
-            numPages--;
-            break;
-        } else {
-            // mark the page as not recently used
-            frame->refBit = false;
-            clockHand = (clockHand + 1) % capacity;
         }
+        for (auto& policy : evictionPolicies) {
+            policy->resize(newCapacity);
+        }
+        releaseRetiredChunks();
+    } else if (newCapacity > oldCapacity) {
+        // frames kept past the old capacity, as they were pinned, come back
+        if (newCapacity > (int)bufferFrames.size()) {
+            addFrames(newCapacity - bufferFrames.size());
+        }
+        for (auto& policy : evictionPolicies) {
+            policy->resize(newCapacity);
+        }
+        for (int frameIdx = newCapacity - 1; frameIdx >= oldCapacity; frameIdx--) {
+            if (bufferFrames[frameIdx].pinCount == 0) {
+                freeFrames.push_back(frameIdx);
+            }
+        }
+    }
+}
+
+int BufferPoolShard::getCapacity() {
+    lock_guard<mutex> lock(shardMutex);
+    return capacity;
+}
+
+int BufferPoolShard::getNumHugePageFrames() {
+    lock_guard<mutex> lock(shardMutex);
+    int numFrames = 0;
+    for (const FrameChunk& chunk : frameChunks) {
+        if (chunk.memory.isHugePageBacked) {
+            numFrames += max(0, min(chunk.numFrames, capacity - chunk.firstFrame));
+        }
+    }
+    return numFrames;
+}
+
+BufferPoolStats BufferPoolShard::getStats() {
+    BufferPoolStats stats;
+    stats.hits = numHits.load(memory_order_relaxed);
+    stats.misses = numMisses.load(memory_order_relaxed);
+    stats.evictions = numEvictions.load(memory_order_relaxed);
+    stats.rejections = numRejections.load(memory_order_relaxed);
+    stats.probes = numProbes.load(memory_order_relaxed);
+    stats.sweepSteps = numSweepSteps.load(memory_order_relaxed);
+    return stats;
+}
+
+array<uint64_t, 2>& BufferPoolShard::sstCounterOf(PageId pageId) {
+    uint32_t sstKey = pageId >> 32;
+    int counterIdx = sstCounterIndex.find(sstKey);
+    if (counterIdx == -1) {
+        counterIdx = sstCounters.size();
+        sstCounterIndex.insert(sstKey, counterIdx);
+        sstCounters.push_back({0, 0});
+        sstCounterKeys.push_back(sstKey);
+    }
+    return sstCounters[counterIdx];
+}
+
+void BufferPoolShard::collectSSTStats(unordered_map<uint32_t, array<uint64_t, 2>>& sstStats) {
+    lock_guard<mutex> lock(shardMutex);
+    for (size_t i = 0; i < sstCounters.size(); i++) {
+        sstStats[sstCounterKeys[i]][0] += sstCounters[i][0];
+        sstStats[sstCounterKeys[i]][1] += sstCounters[i][1];
+    }
+}
+
+void BufferPoolShard::resetStats() {
+    lock_guard<mutex> lock(shardMutex);
+    numHits = 0;
+    numMisses = 0;
+    numEvictions = 0;
+    numRejections = 0;
+    numProbes = 0;
+    numSweepSteps = 0;
+    sstCounters.clear();
+    sstCounterKeys.clear();
+    sstCounterIndex = PageTable();
+}
+
+double BufferPoolStats::hitRate() const {
+    uint64_t lookups = hits + misses;
+    return lookups == 0 ? 0 : (double)hits / lookups;
+}
+
+double BufferPoolStats::averageProbeLength() const {
+    uint64_t lookups = hits + misses;
+    return lookups == 0 ? 0 : (double)probes / lookups;
+}
+
+double BufferPoolStats::averageSweepLength() const {
+    return evictions == 0 ? 0 : (double)sweepSteps / evictions;
+}
+
+BufferPoolStats& BufferPoolStats::operator+=(const BufferPoolStats& other) {
+    hits += other.hits;
+    misses += other.misses;
+    evictions += other.evictions;
+    rejections += other.rejections;
+    probes += other.probes;
+    sweepSteps += other.sweepSteps;
+    return *this;
+}
+
+BufferPool::BufferPool(int capacity, BufferPoolOptions options) : capacity(capacity) {
+    int numShards = options.numShards;
+    if (numShards <= 0) {
+        numShards = min(MAX_DEFAULT_SHARDS, max(1, capacity / MIN_PAGES_PER_SHARD));
+    }
+    numShards = max(1, min(numShards, max(capacity, 1)));
+
+    // one region for the frames of every shard, large enough for huge pages
+    FrameMemory frameMemory =
+        FrameMemory::map((size_t)max(capacity, 0) * PAGE_SIZE, options.useHugePages);
+    size_t frameOffset = 0;
+
+    for (int i = 0; i < numShards; i++) {
+        int capacityOfShard = shardCapacity(capacity, numShards, i);
+        int sketchWidth = options.admissionSketchWidth > 0
+                              ? (options.admissionSketchWidth + numShards - 1) / numShards
+                              : 8 * capacityOfShard;
+        shards.push_back(make_unique<BufferPoolShard>(
+            capacityOfShard, options.evictionPolicy,
+            AdmissionFilter::create(options.admissionPolicy, sketchWidth),
+            options.highPriorityRatio, options.useHugePages,
+            capacityOfShard > 0 ? frameMemory.slice(frameOffset) : FrameMemory()));
+        frameOffset += (size_t)capacityOfShard * PAGE_SIZE;
     }
 }
 
+PageId BufferPool::makePageId(int sstIdx, int pageNum) {
+    return makeLeveledPageId(0, sstIdx, pageNum);
+}
+
+PageId BufferPool::makeLeveledPageId(int sstLevel, int sstIdx, int pageNum) {
+    return ((PageId)(uint16_t)sstLevel << 48) |
+           ((PageId)(uint16_t)sstIdx << 32) | (uint32_t)pageNum;
+}
+
+PageId BufferPool::makeIndexPageId(int sstIdx, int nodeNum) {
+    return makeLeveledPageId(INDEX_PAGE_LEVEL, sstIdx, nodeNum);
+}
+
+int BufferPool::invalidateIndex(int sstIdx) { return invalidateSST(INDEX_PAGE_LEVEL, sstIdx); }
+
+BufferPoolShard& BufferPool::shardOf(PageId pageId) {
+    return *shards[(hashPageId(pageId) >> 32) % shards.size()];
+}
+
+int BufferPool::findPage(int sstIdx, int pageNum) {
+    return shardOf(makePageId(sstIdx, pageNum)).findPage(makePageId(sstIdx, pageNum));
+}
+
+PageHandle BufferPool::getPage(PageId pageId) { return shardOf(pageId).getPage(pageId); }
+
+PageHandle BufferPool::putPage(PageId pageId, KVSpan kvPairs, CacheHint hint,
+                               PagePriority priority) {
+    if (hint == CacheHint::DONT_CACHE) {
+        return PageHandle(vector<array<int, 2>>(kvPairs.begin(), kvPairs.end()));
+    }
+    return shardOf(pageId).putPage(pageId, kvPairs, priority);
+}
+
+PageHandle BufferPool::loadPage(PageId pageId, const PageReader& reader, CacheHint hint,
+                                PagePriority priority) {
+    if (hint == CacheHint::DONT_CACHE) {
+        return readUncachedPage(reader);
+    }
+    return shardOf(pageId).loadPage(pageId, reader, priority);
+}
+
+void BufferPool::updatePage(int sstIdx, int pageNum, vector<array<int, 2>> kvPairs) {
+    PageId pageId = makePageId(sstIdx, pageNum);
+    shardOf(pageId).updatePage(pageId, kvPairs);
+}
+
+int BufferPool::invalidateSST(int sstLevel, int sstIdx) {
+    // the pages of an SST are spread over every shard
+    PageId prefix = makeLeveledPageId(sstLevel, sstIdx, 0) >> 32;
+    int numDropped = 0;
+    for (auto& shard : shards) {
+        numDropped += shard->invalidate(prefix);
+    }
+    return numDropped;
+}
+
 int BufferPool::getCapacity() {
     return capacity;
 }
+
+void BufferPool::resize(int newCapacity) {
+    lock_guard<mutex> lock(resizeMutex);
+    newCapacity = max(newCapacity, 0);
+    for (int i = 0; i < (int)shards.size(); i++) {
+        shards[i]->resize(shardCapacity(newCapacity, shards.size(), i));
+    }
+    capacity = newCapacity;
+}
+
+int BufferPool::getNumShards() { return shards.size(); }
+
+int BufferPool::getNumHugePageFrames() {
+    int numFrames = 0;
+    for (auto& shard : shards) {
+        numFrames += shard->getNumHugePageFrames();
+    }
+    return numFrames;
+}
+
+BufferPoolStats BufferPool::getStats() {
+    BufferPoolStats stats;
+    for (auto& shard : shards) {
+        stats += shard->getStats();
+    }
+    return stats;
+}
+
+vector<BufferPoolStats> BufferPool::getShardStats() {
+    vector<BufferPoolStats> shardStats;
+    for (auto& shard : shards) {
+        shardStats.push_back(shard->getStats());
+    }
+    return shardStats;
+}
+
+vector<SSTCacheStats> BufferPool::getSSTStats() {
+    // the pages of an SST are spread over every shard
+    unordered_map<uint32_t, array<uint64_t, 2>> sstCounters;
+    for (auto& shard : shards) {
+        shard->collectSSTStats(sstCounters);
+    }
+
+    vector<SSTCacheStats> sstStats;
+    for (const auto& [sstKey, counter] : sstCounters) {
+        sstStats.push_back({(int)(sstKey >> 16), (int)(sstKey & 0xffff), counter[0], counter[1]});
+    }
+    sort(sstStats.begin(), sstStats.end(), [](const SSTCacheStats& a, const SSTCacheStats& b) {
+        return a.level != b.level ? a.level < b.level : a.sstIdx < b.sstIdx;
+    });
+    return sstStats;
+}
+
+void BufferPool::resetStats() {
+    for (auto& shard : shards) {
+        shard->resetStats();
+    }
+}
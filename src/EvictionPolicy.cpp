@@ -0,0 +1,173 @@
+#include "EvictionPolicy.h"
+
+#include <algorithm>
+
+#include "BufferPool.h"
+
+unique_ptr<EvictionPolicy> EvictionPolicy::create(EvictionPolicyType type, int capacity) {
+    if (type == EvictionPolicyType::TWO_QUEUE) {
+        return make_unique<TwoQueuePolicy>(capacity);
+    }
+    return make_unique<ClockPolicy>(capacity);
+}
+
+ClockPolicy::ClockPolicy(int capacity)
+    : capacity(capacity), clockHand(0), refBits(capacity, false), isTracked(capacity, false) {}
+
+void ClockPolicy::onInsert(int frameIdx, PageId /*pageId*/) {
+    isTracked[frameIdx] = true;
+    refBits[frameIdx] = true;  // mark as recently used
+}
+
+void ClockPolicy::onAccess(int frameIdx) { refBits[frameIdx] = true; }
+
+void ClockPolicy::onRemove(int frameIdx) { isTracked[frameIdx] = false; }
+
+int ClockPolicy::pickVictim(const vector<BufferFrame>& frames, uint64_t& numSteps) {
+    // two sweeps clear every reference bit, so after them all frames are pinned
+    for (int step = 0; step < 2 * capacity; step++) {
+        numSteps++;
+        int frameIdx = clockHand;
+        clockHand = (clockHand + 1) % capacity;
+
+        if (!isTracked[frameIdx] || frames[frameIdx].pinCount > 0) {
+            continue;
+        }
+
+        // if the reference bit is 0, evict the page
+        if (!refBits[frameIdx]) {
+            return frameIdx;
+        }
+
+        // mark the page as not recently used
+        refBits[frameIdx] = false;
+    }
+    return -1;
+}
+
+void ClockPolicy::onEvict(int frameIdx) { isTracked[frameIdx] = false; }
+
+void ClockPolicy::resize(int newCapacity) {
+    capacity = newCapacity;
+    clockHand = capacity > 0 ? clockHand % capacity : 0;
+    refBits.resize(capacity, false);
+    isTracked.resize(capacity, false);
+}
+
+TwoQueuePolicy::TwoQueuePolicy(int capacity)
+    : recentCapacity(max(1, capacity / 4)),
+      ghostCapacity(max(1, capacity / 2)),
+      prevFrame(capacity, -1),
+      nextFrame(capacity, -1),
+      queueOf(capacity, NONE),
+      pageIdOf(capacity, 0) {}
+
+void TwoQueuePolicy::pushFront(FrameList& list, Queue queue, int frameIdx) {
+    prevFrame[frameIdx] = -1;
+    nextFrame[frameIdx] = list.head;
+    if (list.head != -1) {
+        prevFrame[list.head] = frameIdx;
+    } else {
+        list.tail = frameIdx;
+    }
+    list.head = frameIdx;
+    list.size++;
+    queueOf[frameIdx] = queue;
+}
+
+void TwoQueuePolicy::unlink(int frameIdx) {
+    if (queueOf[frameIdx] == NONE) {
+        return;
+    }
+
+    FrameList& list = queueOf[frameIdx] == RECENT ? recent : frequent;
+    int prev = prevFrame[frameIdx];
+    int next = nextFrame[frameIdx];
+    if (prev != -1) {
+        nextFrame[prev] = next;
+    } else {
+        list.head = next;
+    }
+    if (next != -1) {
+        prevFrame[next] = prev;
+    } else {
+        list.tail = prev;
+    }
+    list.size--;
+    queueOf[frameIdx] = NONE;
+}
+
+void TwoQueuePolicy::rememberGhost(PageId pageId) {
+    ghostQueue.push_back(pageId);
+    ghostCounts[pageId]++;
+    trimGhosts();
+}
+
+void TwoQueuePolicy::trimGhosts() {
+    while ((int)ghostQueue.size() > ghostCapacity) {
+        PageId oldest = ghostQueue.front();
+        ghostQueue.pop_front();
+        if (--ghostCounts[oldest] == 0) {
+            ghostCounts.erase(oldest);
+        }
+    }
+}
+
+int TwoQueuePolicy::findUnpinned(const FrameList& list, const vector<BufferFrame>& frames,
+                                 uint64_t& numSteps) {
+    for (int frameIdx = list.tail; frameIdx != -1; frameIdx = prevFrame[frameIdx]) {
+        numSteps++;
+        if (frames[frameIdx].pinCount == 0) {
+            return frameIdx;
+        }
+    }
+    return -1;
+}
+
+void TwoQueuePolicy::onInsert(int frameIdx, PageId pageId) {
+    pageIdOf[frameIdx] = pageId;
+    // a page read again soon after leaving the recent queue is hot
+    if (ghostCounts.count(pageId) > 0) {
+        pushFront(frequent, FREQUENT, frameIdx);
+    } else {
+        pushFront(recent, RECENT, frameIdx);
+    }
+}
+
+void TwoQueuePolicy::onAccess(int frameIdx) {
+    // reads of a page in the recent queue are likely correlated, e.g. by a
+    // scan, so only the frequent queue is reordered
+    if (queueOf[frameIdx] == FREQUENT) {
+        unlink(frameIdx);
+        pushFront(frequent, FREQUENT, frameIdx);
+    }
+}
+
+void TwoQueuePolicy::onRemove(int frameIdx) { unlink(frameIdx); }
+
+int TwoQueuePolicy::pickVictim(const vector<BufferFrame>& frames, uint64_t& numSteps) {
+    bool isRecentFirst = recent.size > recentCapacity || frequent.size == 0;
+
+    int frameIdx = findUnpinned(isRecentFirst ? recent : frequent, frames, numSteps);
+    if (frameIdx == -1) {
+        frameIdx = findUnpinned(isRecentFirst ? frequent : recent, frames, numSteps);
+    }
+    return frameIdx;
+}
+
+void TwoQueuePolicy::onEvict(int frameIdx) {
+    if (queueOf[frameIdx] == RECENT) {
+        rememberGhost(pageIdOf[frameIdx]);
+    }
+    unlink(frameIdx);
+}
+
+void TwoQueuePolicy::resize(int capacity) {
+    recentCapacity = max(1, capacity / 4);
+    ghostCapacity = max(1, capacity / 2);
+    prevFrame.resize(capacity, -1);
+    nextFrame.resize(capacity, -1);
+    queueOf.resize(capacity, NONE);
+    pageIdOf.resize(capacity, 0);
+    trimGhosts();
+}
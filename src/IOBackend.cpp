@@ -0,0 +1,303 @@
+//
+// Submits batches of page reads and writes to the SST files
+//
+
+#include "IOBackend.h"
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#if __has_include(<linux/io_uring.h>) && defined(__NR_io_uring_setup) && \
+    defined(__NR_io_uring_register)
+#include <linux/io_uring.h>
+#define HAS_IO_URING 1
+#endif
+
+// the number of threads of the fallback, which block in the kernel
+const int MAX_IO_THREADS = 8;
+
+// issues one request with a blocking call
+static ssize_t performRequest(const IORequest &theRequest) {
+    ssize_t result = theRequest.op == IORequest::READ
+                     ? pread(theRequest.fd, theRequest.buffer, theRequest.length, theRequest.offset)
+                     : pwrite(theRequest.fd, theRequest.buffer, theRequest.length, theRequest.offset);
+    return result < 0 ? -errno : result;
+}
+
+unique_ptr<IOBackend> IOBackend::create(IOBackendType theType, int theQueueDepth) {
+    theQueueDepth = max(theQueueDepth, 1);
+    if (theType == IOBackendType::IO_URING) {
+        unique_ptr<IOUringBackend> ring = IOUringBackend::create(theQueueDepth);
+        if (ring) {
+            return ring;
+        }
+    }
+    return make_unique<ThreadPoolBackend>(theQueueDepth);
+}
+
+ThreadPoolBackend::ThreadPoolBackend(int theQueueDepth) : myIsStopping(false) {
+    int numWorkers = min(max(theQueueDepth, 1), MAX_IO_THREADS);
+    for (int i = 0; i < numWorkers; i++) {
+        myWorkers.emplace_back(&ThreadPoolBackend::work, this);
+    }
+}
+
+ThreadPoolBackend::~ThreadPoolBackend() {
+    {
+        lock_guard<mutex> lock(myMutex);
+        myIsStopping = true;
+    }
+    myWorkCondition.notify_all();
+    for (thread &worker: myWorkers) {
+        worker.join();
+    }
+}
+
+void ThreadPoolBackend::work() {
+    unique_lock<mutex> lock(myMutex);
+    while (true) {
+        myWorkCondition.wait(lock, [this] { return myIsStopping || !myQueue.empty(); });
+        if (myQueue.empty()) {
+            return;
+        }
+
+        auto [request, remaining] = myQueue.front();
+        myQueue.pop_front();
+
+        lock.unlock();
+        request->result = performRequest(*request);
+        lock.lock();
+
+        if (--*remaining == 0) {
+            myDoneCondition.notify_all();
+        }
+    }
+}
+
+void ThreadPoolBackend::submitAndWait(vector<IORequest> &theRequests) {
+    if (theRequests.empty()) {
+        return;
+    }
+
+    int remaining = theRequests.size();
+    unique_lock<mutex> lock(myMutex);
+    for (IORequest &request: theRequests) {
+        myQueue.emplace_back(&request, &remaining);
+    }
+    myWorkCondition.notify_all();
+    myDoneCondition.wait(lock, [&remaining] { return remaining == 0; });
+}
+
+IOBackendType ThreadPoolBackend::getType() {
+    return IOBackendType::THREAD_POOL;
+}
+
+#ifdef HAS_IO_URING
+
+static int ioUringSetup(unsigned theEntries, io_uring_params *theParams) {
+    return syscall(__NR_io_uring_setup, theEntries, theParams);
+}
+
+static int ioUringEnter(int theRingFd, unsigned theToSubmit, unsigned theMinComplete) {
+    return syscall(__NR_io_uring_enter, theRingFd, theToSubmit, theMinComplete,
+                   IORING_ENTER_GETEVENTS, nullptr, 0);
+}
+
+static int ioUringRegister(int theRingFd, unsigned theOpcode, void *theArg, unsigned theNumArgs) {
+    return syscall(__NR_io_uring_register, theRingFd, theOpcode, theArg, theNumArgs);
+}
+
+// whether the ring supports the reads and writes of the requests, which a
+// kernel without them fails with -EINVAL on completion
+static bool isSupportingReadWrite(int theRingFd) {
+    const unsigned numOps = 256;
+    vector<char> memory(sizeof(io_uring_probe) + numOps * sizeof(io_uring_probe_op), 0);
+    auto *probe = reinterpret_cast<io_uring_probe *>(memory.data());
+    if (ioUringRegister(theRingFd, IORING_REGISTER_PROBE, probe, numOps) < 0) {
+        // the kernels before the probe lack IORING_OP_READ and IORING_OP_WRITE
+        return false;
+    }
+
+    for (int op: {IORING_OP_READ, IORING_OP_WRITE}) {
+        if (op > probe->last_op || !(probe->ops[op].flags & IO_URING_OP_SUPPORTED)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+unique_ptr<IOUringBackend> IOUringBackend::create(int theQueueDepth) {
+    io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    int ringFd = ioUringSetup(theQueueDepth, &params);
+    if (ringFd < 0) {
+        // e.g. an old kernel, or io_uring disabled by a seccomp filter
+        return nullptr;
+    }
+
+    unique_ptr<IOUringBackend> backend(new IOUringBackend(ringFd));
+    backend->myQueueDepth = params.sq_entries;
+    if (!isSupportingReadWrite(ringFd)) {
+        return nullptr;
+    }
+
+    backend->mySQRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    backend->myCQRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    bool isSingleMap = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (isSingleMap) {
+        backend->mySQRingSize = backend->myCQRingSize =
+                max(backend->mySQRingSize, backend->myCQRingSize);
+    }
+
+    void *sqRing = mmap(nullptr, backend->mySQRingSize, PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQ_RING);
+    if (sqRing == MAP_FAILED) {
+        return nullptr;
+    }
+    backend->mySQRing = sqRing;
+
+    void *cqRing = sqRing;
+    if (!isSingleMap) {
+        cqRing = mmap(nullptr, backend->myCQRingSize, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_CQ_RING);
+        if (cqRing == MAP_FAILED) {
+            return nullptr;
+        }
+    }
+    backend->myCQRing = cqRing;
+
+    backend->mySQEsSize = params.sq_entries * sizeof(io_uring_sqe);
+    void *sqes = mmap(nullptr, backend->mySQEsSize, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED) {
+        return nullptr;
+    }
+    backend->mySQEs = sqes;
+
+    char *sq = static_cast<char *>(sqRing);
+    char *cq = static_cast<char *>(cqRing);
+    backend->mySQTail = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+    backend->mySQMask = reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+    backend->mySQArray = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+    backend->myCQHead = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+    backend->myCQTail = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+    backend->myCQMask = reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+    backend->myCQEs = cq + params.cq_off.cqes;
+    return backend;
+}
+
+void IOUringBackend::submitChunk(IORequest *theRequests, unsigned theNumRequests) {
+    // only this thread produces entries, so the tail is read without ordering
+    unsigned tail = *mySQTail;
+    auto *sqes = static_cast<io_uring_sqe *>(mySQEs);
+    for (unsigned i = 0; i < theNumRequests; i++) {
+        unsigned idx = tail & *mySQMask;
+        io_uring_sqe &sqe = sqes[idx];
+        memset(&sqe, 0, sizeof(sqe));
+        sqe.opcode = theRequests[i].op == IORequest::READ ? IORING_OP_READ : IORING_OP_WRITE;
+        sqe.fd = theRequests[i].fd;
+        sqe.addr = reinterpret_cast<uint64_t>(theRequests[i].buffer);
+        sqe.len = theRequests[i].length;
+        sqe.off = theRequests[i].offset;
+        sqe.user_data = i;
+        mySQArray[idx] = idx;
+        tail++;
+    }
+    // the kernel reads the entries once it sees the new tail
+    __atomic_store_n(mySQTail, tail, __ATOMIC_RELEASE);
+
+    unsigned numSubmitted = 0;
+    unsigned numCompleted = 0;
+    auto *cqes = static_cast<io_uring_cqe *>(myCQEs);
+    while (numCompleted < theNumRequests) {
+        int result = ioUringEnter(myRingFd, theNumRequests - numSubmitted,
+                                  theNumRequests - numCompleted);
+        if (result >= 0) {
+            numSubmitted += result;
+        } else if (errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+            // the entries left in the ring could run later over freed buffers
+            throw runtime_error(string("Error submitting I/O: ") + strerror(errno));
+        }
+        // otherwise retry once the completions below make room
+
+        unsigned head = *myCQHead;
+        unsigned cqTail = __atomic_load_n(myCQTail, __ATOMIC_ACQUIRE);
+        for (; head != cqTail; head++) {
+            io_uring_cqe &cqe = cqes[head & *myCQMask];
+            theRequests[cqe.user_data].result = cqe.res;
+            numCompleted++;
+        }
+        __atomic_store_n(myCQHead, head, __ATOMIC_RELEASE);
+    }
+}
+
+#else
+
+unique_ptr<IOUringBackend> IOUringBackend::create(int /*theQueueDepth*/) {
+    return nullptr;
+}
+
+void IOUringBackend::submitChunk(IORequest *theRequests, unsigned theNumRequests) {
+    for (unsigned i = 0; i < theNumRequests; i++) {
+        theRequests[i].result = performRequest(theRequests[i]);
+    }
+}
+
+#endif
+
+IOUringBackend::IOUringBackend(int theRingFd)
+        : myRingFd(theRingFd), myQueueDepth(0), mySQRing(nullptr), mySQRingSize(0),
+          myCQRing(nullptr), myCQRingSize(0), mySQEs(nullptr), mySQEsSize(0) {}
+
+IOUringBackend::~IOUringBackend() {
+    if (mySQEs != nullptr) {
+        munmap(mySQEs, mySQEsSize);
+    }
+    if (myCQRing != nullptr && myCQRing != mySQRing) {
+        munmap(myCQRing, myCQRingSize);
+    }
+    if (mySQRing != nullptr) {
+        munmap(mySQRing, mySQRingSize);
+    }
+    close(myRingFd);
+}
+
+void IOUringBackend::submitAndWait(vector<IORequest> &theRequests) {
+    unique_lock<mutex> lock(myMutex);
+    if (myFallback) {
+        // the thread pool takes concurrent batches, and is never reset
+        lock.unlock();
+        myFallback->submitAndWait(theRequests);
+        return;
+    }
+
+    for (size_t first = 0; first < theRequests.size(); first += myQueueDepth) {
+        unsigned numRequests = min((size_t) myQueueDepth, theRequests.size() - first);
+        submitChunk(theRequests.data() + first, numRequests);
+    }
+
+    // a kernel may still reject the requests of the ring with -EINVAL, so
+    // they are issued again with blocking calls. If one of them then
+    // succeeds, the later batches go to the thread pool.
+    for (IORequest &request: theRequests) {
+        if (request.result != -EINVAL) {
+            continue;
+        }
+        request.result = performRequest(request);
+        if (request.result >= 0 && !myFallback) {
+            myFallback = make_unique<ThreadPoolBackend>(myQueueDepth);
+        }
+    }
+}
+
+IOBackendType IOUringBackend::getType() {
+    lock_guard<mutex> lock(myMutex);
+    return myFallback ? IOBackendType::THREAD_POOL : IOBackendType::IO_URING;
+}
@@ -0,0 +1,90 @@
+#include "KVIterator.h"
+
+#include <algorithm>
+#include <cstdint>
+
+VectorIterator::VectorIterator(const vector<array<int, 2>> &theKVPairs)
+        : myKVPairs(theKVPairs), myIdx(0) {}
+
+void VectorIterator::seekToFirst() { myIdx = 0; }
+
+void VectorIterator::seek(int theTarget) {
+    auto it = lower_bound(myKVPairs.begin(), myKVPairs.end(), theTarget,
+                          [](const array<int, 2> &pair, int target) {
+                              return pair[0] < target;
+                          });
+    myIdx = it - myKVPairs.begin();
+}
+
+bool VectorIterator::valid() { return myIdx < myKVPairs.size(); }
+
+void VectorIterator::next() { myIdx++; }
+
+int VectorIterator::key() { return myKVPairs[myIdx][0]; }
+
+int VectorIterator::value() { return myKVPairs[myIdx][1]; }
+
+MergingIterator::MergingIterator(KVIterator &theNewer, KVIterator &theOlder,
+                                 bool theDropTombstones)
+        : myNewer(theNewer), myOlder(theOlder),
+          myDropTombstones(theDropTombstones), myCurrent(nullptr),
+          myIsShadowing(false) {}
+
+void MergingIterator::seekToFirst() {
+    myNewer.seekToFirst();
+    myOlder.seekToFirst();
+    findCurrent();
+}
+
+void MergingIterator::seek(int theTarget) {
+    myNewer.seek(theTarget);
+    myOlder.seek(theTarget);
+    findCurrent();
+}
+
+bool MergingIterator::valid() { return myCurrent != nullptr; }
+
+void MergingIterator::next() {
+    advance();
+    findCurrent();
+}
+
+int MergingIterator::key() { return myCurrent->key(); }
+
+int MergingIterator::value() { return myCurrent->value(); }
+
+void MergingIterator::advance() {
+    // skip the shadowed pair in the older iterator as well
+    if (myIsShadowing) {
+        myOlder.next();
+    }
+    myCurrent->next();
+}
+
+void MergingIterator::findCurrent() {
+    while (true) {
+        bool isNewerValid = myNewer.valid();
+        bool isOlderValid = myOlder.valid();
+
+        if (!isNewerValid && !isOlderValid) {
+            myCurrent = nullptr;
+            myIsShadowing = false;
+            return;
+        }
+
+        // use the pair from the newer iterator if the key equals
+        if (!isOlderValid || (isNewerValid && myNewer.key() <= myOlder.key())) {
+            myCurrent = &myNewer;
+            myIsShadowing = isOlderValid && myOlder.key() == myNewer.key();
+        } else {
+            myCurrent = &myOlder;
+            myIsShadowing = false;
+        }
+
+        if (myDropTombstones && myCurrent->value() == INT32_MIN) {
+            advance();
+            continue;
+        }
+        return;
+    }
+}
@@ -4,12 +4,13 @@
 
 #include "KVStore.h"
 
-#include <cstring>
 
-KVStore::KVStore(int memtableSize, string dBName, int bufferCapacity) {
+KVStore::KVStore(int memtableSize, string dBName, int bufferCapacity,
+                 bool useMmapReads) {
     myMemtableSize = memtableSize;
     myMemtable = make_shared<AVLTree>(memtableSize);
-    mySSTController = make_shared<SSTController>(dBName, bufferCapacity);
+    mySSTController = make_shared<SSTController>(
+        dBName, bufferCapacity, DEFAULT_MAX_OPEN_FILES, useMmapReads);
     myBTreeController = make_shared<BTreeController>(dBName, mySSTController);
 }
 
@@ -26,8 +27,8 @@ bool KVStore::put(int key, int value) {
         const vector<array<int, 2>> &buffer = myMemtable->scan();
         mySSTController->save(buffer);
 
-        // clean the memtable by creating a new tree
-        myMemtable = make_shared<AVLTree>(myMemtableSize);
+        // clean the memtable, reusing its node arena
+        myMemtable->clear();
         return put(key, value);
     }
 
@@ -35,21 +36,19 @@ bool KVStore::put(int key, int value) {
 }
 
 int KVStore::get(int key) {
-    int result;
-
-    try {
-        result = myMemtable->getValue(key);
-    } catch (const exception &e) {
-        // if not found in memtable, search the SSTs instead
-        if (strcmp(e.what(), "Key not found") == 0) {
-            const pair<bool, int> &pair = mySSTController->get(key);
-
-            if (pair.first) {
-                result = pair.second;
-            } else {
-                throw std::runtime_error("Key not found");
-            }
-        }
+    optional<int> result = tryGet(key);
+    if (!result) {
+        throw std::runtime_error("Key not found");
+    }
+    return *result;
+}
+
+optional<int> KVStore::tryGet(int key) {
+    optional<int> result = myMemtable->tryGet(key);
+
+    // if not found in memtable, search the SSTs instead
+    if (!result) {
+        result = mySSTController->tryGet(key);
     }
 
     return result;
@@ -109,27 +108,19 @@ bool KVStore::close() {
 void KVStore::createStaticBTree() { myBTreeController->createBTrees(); }
 
 int KVStore::bTreeGet(int key) {
-    int result;
-    try {
-        result = myMemtable->getValue(key);
-    } catch (const exception &e) {
-        // if not found in memtable, search the SSTs instead
-        if (strcmp(e.what(), "Key not found") == 0) {
-            const pair<bool, int> &pair = mySSTController->get(key);
-
-            if (pair.first) {
-                result = pair.second;
-            } else {
-                throw std::runtime_error("Key not found");
-            }
-        }
+    optional<int> result = bTreeTryGet(key);
+    if (!result) {
+        throw std::runtime_error("Key not found");
     }
+    return *result;
+}
 
-    const pair<bool, int> &pair = myBTreeController->get(key);
-    if (pair.first) {
-        result = pair.second;
-    } else {
-        throw std::runtime_error("Key not found");
+optional<int> KVStore::bTreeTryGet(int key) {
+    optional<int> result = myMemtable->tryGet(key);
+
+    // if not found in memtable, search the B-trees of the SSTs instead
+    if (!result) {
+        result = myBTreeController->tryGet(key);
     }
 
     return result;
@@ -4,6 +4,7 @@
 
 #include "LSMController.h"
 
+#include <sys/mman.h>
 #include <sys/stat.h>
 
 #include <algorithm>
@@ -18,34 +19,68 @@
 #include "Constants.h"
 
 #include "SSTController.h"
+#include "SSTWriter.h"
 
 namespace fs = std::filesystem;
 
+// returns the given page (1-indexed) of the KV-pairs of an SST
+static KVSpan pageOf(KVSpan theSST, int thePageNum) {
+    size_t first = (size_t) (thePageNum - 1) * B;
+    if (first >= theSST.size()) {
+        return KVSpan();
+    }
+    return KVSpan(theSST.data() + first, min((size_t) B, theSST.size() - first));
+}
+
 string METADATA_FILENAME_LSM = "metadata";
 string SST_FILENAME_LSM = "sst-";
 int SIZE_RATIO = 2;
 
-LSMController::LSMController(string theDbName, int bufferPoolCapacity)
-        : bufferPool(bufferPoolCapacity), myDbName(std::move(theDbName)) {
+LSMController::LSMController(string theDbName, int bufferPoolCapacity,
+                             LSMOptions theOptions)
+        : bufferPool(bufferPoolCapacity, theOptions.bufferPoolOptions),
+          myDbName(std::move(theDbName)), myOptions(theOptions),
+          myReadahead(theOptions.readaheadMaxPages),
+          myTableCache(theOptions.maxOpenFiles, theOptions.useDirectIO),
+          myIOBackend(IOBackend::create(theOptions.ioBackend, theOptions.ioQueueDepth)) {
+    myOptions.ioQueueDepth = max(myOptions.ioQueueDepth, 1);
+
     // Step 1: create the directory and metadata if not exist
     if (mkdir(myDbName.c_str(), 0777) == 0) {
-        updateMetaData();
+        updateMetaData(myLevelMap);
         return;
     }
 
     // Step 2: read the metaData
     readMetaData();
+
+    // Step 3: finish a compaction interrupted by a crash, as the reads expect
+    // at most one SST per level
+    for (const auto &[level, numSSTs]: myLevelMap) {
+        if (numSSTs >= 2) {
+            unordered_map<int, int> levelMap = myLevelMap;
+            vector<pair<int, int>> staleSSTs;
+            if (!performCompaction(levelMap, staleSSTs) || updateMetaData(levelMap) == -1) {
+                throw runtime_error("Error when finishing an interrupted compaction");
+            }
+            installSSTs(std::move(levelMap), staleSSTs, nullptr);
+            break;
+        }
+    }
 }
 
-int LSMController::updateMetaData() {
-    cout << "Storing Metadata..." << endl;
-    ofstream outputFile(buildPath(METADATA_FILENAME_LSM));
+int LSMController::updateMetaData(const unordered_map<int, int> &theLevelMap) {
+    // write a new file and rename it over the old one, so a crash never
+    // leaves a partial metadata file behind
+    string pathToMetaData = buildPath(METADATA_FILENAME_LSM);
+    string pathToNewMetaData = pathToMetaData + ".tmp";
+    ofstream outputFile(pathToNewMetaData);
     if (!outputFile) {
         return -1;
     }
 
     // Write each key-value pair to the file
-    for (const auto &[key, value]: myLevelMap) {
+    for (const auto &[key, value]: theLevelMap) {
         outputFile << key << " " << value << "\n";
     }
 
@@ -54,7 +89,16 @@ int LSMController::updateMetaData() {
     }
 
     outputFile.close();
-    cout << "Metadata Stored." << endl;
+
+    int fd = open(pathToNewMetaData.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+    bool isSynced = fsync(fd) == 0;
+    ::close(fd);
+    if (!isSynced || rename(pathToNewMetaData.c_str(), pathToMetaData.c_str()) != 0) {
+        return -1;
+    }
     return 0;
 }
 
@@ -83,6 +127,7 @@ int LSMController::readMetaData() {
 }
 
 void LSMController::deleteFiles() {
+    myTableCache.clear();
     try {
         if (std::filesystem::exists(myDbName)) {
             std::filesystem::remove_all(myDbName);
@@ -95,7 +140,17 @@ void LSMController::deleteFiles() {
 }
 
 bool LSMController::save(vector<array<int, 2>> theKVPairs, int theLevel) {
-    bool isSaved = performSave(theKVPairs, theLevel);
+    VectorIterator iterator(theKVPairs);
+    return save(iterator, theLevel, theKVPairs.size());
+}
+
+bool LSMController::save(KVIterator &theIterator, int theLevel, size_t theNumKVPairs,
+                         shared_mutex *theReadersMutex) {
+    // the SSTs are saved and compacted on a copy of the level map, into files
+    // the readers do not reach until the copy is installed, so a failure
+    // leaves the SSTs as they were
+    unordered_map<int, int> levelMap = myLevelMap;
+    bool isSaved = performSave(theIterator, levelMap, theLevel, false, theNumKVPairs);
 
     // do compaction if needed
     if (!isSaved) {
@@ -103,20 +158,58 @@ bool LSMController::save(vector<array<int, 2>> theKVPairs, int theLevel) {
         return false;
     }
 
-    if (myLevelMap[theLevel] == 2) {
-        performCompaction();
-        invalidateBufferPool();
+    vector<pair<int, int>> staleSSTs;
+    if (levelMap[theLevel] == 2 && !performCompaction(levelMap, staleSSTs)) {
+        cerr << "error when performing compaction" << endl;
+        return false;
     }
 
+    // persist the new SSTs right away, so the write-ahead log of the saved
+    // KV-pairs can be dropped
+    if (updateMetaData(levelMap) == -1) {
+        cerr << "error when storing metadata" << endl;
+        return false;
+    }
+
+    installSSTs(std::move(levelMap), staleSSTs, theReadersMutex);
     return true;
 }
 
-bool LSMController::performSave(vector<array<int, 2>> theKVPairs, int theLevel) {
+void LSMController::installSSTs(unordered_map<int, int> theLevelMap,
+                                const vector<pair<int, int>> &theStaleSSTs,
+                                shared_mutex *theReadersMutex) {
+    {
+        unique_lock<shared_mutex> readersLock;
+        if (theReadersMutex != nullptr) {
+            readersLock = unique_lock<shared_mutex>(*theReadersMutex);
+        }
+        myLevelMap = std::move(theLevelMap);
+    }
+
+    // the readers no longer reach the merged SSTs. A file left behind is not
+    // in the metadata, and is overwritten when its path is reused.
+    for (const auto &[level, sstNum]: theStaleSSTs) {
+        string path = existingSSTPath(level, sstNum);
+        if (remove(path.c_str()) != 0) {
+            cerr << "error when removing SST: " + path << endl;
+        }
+        forgetSST(level, sstNum);
+    }
+}
+
+bool LSMController::performSave(KVIterator &theIterator, unordered_map<int, int> &theLevelMap,
+                                int theLevel, bool theIsCachingPages, size_t theNumKVPairs) {
     // return if empty pairs
-    if (theKVPairs.empty()) return true;
+    if (!theIterator.valid()) return true;
 
     // insert the KVPairs into the given level
-    string pathToSST = newSSTPath(theLevel);
+    int sstNum = newSSTNum(theLevelMap, theLevel);
+    string pathToSST = existingSSTPath(theLevel, sstNum);
+
+    // the SST reuses the path, and thus the page ids, of a removed one, so
+    // drop whatever may be left of it
+    forgetSST(theLevel, sstNum);
+
     // create the directory first if it does not exist already
     string pathToDir = pathToSST.substr(0, pathToSST.size() - 6);
     if (access(pathToDir.c_str(), F_OK) == -1) {
@@ -126,139 +219,258 @@ bool LSMController::performSave(vector<array<int, 2>> theKVPairs, int theLevel)
         }
     }
 
-    int fd = open(pathToSST.c_str(), O_WRONLY | O_CREAT , 0777);
+    bool isDirect;
+    int fd = openFile(pathToSST, O_WRONLY | O_CREAT | O_TRUNC, myOptions.useDirectIO, isDirect,
+                      0777);
     if (fd < 0) {
         std::cerr << "Error opening file for direct I/O: " << strerror(errno)
                   << std::endl;
         return false;
     }
 
-    char *buffer;
-
-    // allocate aligned memory for direct I/O
-    if (posix_memalign((void **)&buffer, 512, PAGE_SIZE) != 0) {
-        std::cerr << "Error allocating aligned memory for direct I/O"
-                  << std::endl;
-        ::close(fd);
-        return false;
-    }
+    // the pages are filled in place in the write buffer, each full buffer
+    // written with one call
+    SSTWriter writer(fd, isDirect, myOptions.writeBufferSize);
+    writer.preallocate(theNumKVPairs);
 
-    size_t totalPairs = theKVPairs.size();
-    size_t totalSize = totalPairs * KVPAIR_SIZE;
-    size_t numPages = (totalSize + PAGE_SIZE - 1) / PAGE_SIZE;
     size_t numKVPairsInPage = PAGE_SIZE / KVPAIR_SIZE;
-
-    size_t pairsWritten = 0;
-    for (size_t pageNum = 0; pageNum < numPages; ++pageNum) {
-        // calculate how many key-value pairs can fit in the current page
-        size_t numKVPairsToWrite =
-            std::min(numKVPairsInPage, totalPairs - pairsWritten);
-
-        // copy the data for this page into the buffer
-        memcpy(buffer, &theKVPairs[pageNum * numKVPairsInPage],
-               numKVPairsToWrite * KVPAIR_SIZE);
-
-        // write the buffer to the SST file using pwrite (at an offset)
-        int offset = pageNum * PAGE_SIZE;
-        ssize_t bytesWritten =
-            pwrite(fd, buffer, numKVPairsToWrite * KVPAIR_SIZE, offset);
-        if (bytesWritten < 0) {
-            std::cerr << "Error writing data: " << strerror(errno)
-                      << " (errno: " << errno << ")" << std::endl;
-            free(buffer);
+    for (size_t pageNum = 0; theIterator.valid(); pageNum++) {
+        array<int, 2> *pagePairs = writer.nextPage();
+        if (pagePairs == nullptr) {
             ::close(fd);
             return false;
         }
 
-        // update the number of pairs written
-        pairsWritten += numKVPairsToWrite;
+        // fill the next page with key-value pairs
+        size_t numKVPairsToWrite = 0;
+        while (numKVPairsToWrite < numKVPairsInPage && theIterator.valid()) {
+            pagePairs[numKVPairsToWrite] = {theIterator.key(), theIterator.value()};
+            numKVPairsToWrite++;
+            theIterator.next();
+        }
+
+        if (theIsCachingPages) {
+            // the handle is dropped right away, leaving the page unpinned
+            bufferPool.putPage(
+                BufferPool::makeLeveledPageId(theLevel, sstNum, pageNum + 1),
+                KVSpan(pagePairs, numKVPairsToWrite));
+        }
+        writer.addPage(numKVPairsToWrite);
     }
 
-    free(buffer);
+    if (!writer.finish()) {
+        ::close(fd);
+        return false;
+    }
     ::close(fd);
 
     // update the metadata
     // if the first level does not exist yet
-    if (myLevelMap.find(theLevel) == myLevelMap.end()) {
-        myLevelMap[theLevel] = 1;
+    if (theLevelMap.find(theLevel) == theLevelMap.end()) {
+        theLevelMap[theLevel] = 1;
     } else {
-        myLevelMap[theLevel] += 1;
+        theLevelMap[theLevel] += 1;
     }
 
     return true;
 }
 
-vector<array<int, 2>> LSMController::read(int theLevel, int thePageNum, int theSSTNum) {
+PageHandle LSMController::read(int theLevel, int thePageNum, int theSSTNum,
+                               CacheHint theHint) {
+    // a mapped SST is read in place, skipping the readahead of file reads
+    if (myOptions.useMmapReads) {
+        shared_ptr<OpenFile> file;
+        KVSpan sst = mapSST(theLevel, theSSTNum, file);
+        if (!sst.empty()) {
+            return PageHandle(pageOf(sst, thePageNum), file);
+        }
+    }
+
     // check buffer pool for page first
-    vector<array<int, 2>> pageKVPairs =
-            bufferPool.getPage(bufferPool.makeLeveledPageId(theLevel, theSSTNum, thePageNum));
+    PageId pageId = BufferPool::makeLeveledPageId(theLevel, theSSTNum, thePageNum);
+    PageHandle page = bufferPool.getPage(pageId);
 
-    if (!pageKVPairs.empty()) {
-        return pageKVPairs;
+    if (!page.empty()) {
+        return page;
     }
 
-    // if we reach here, the page is not in buffer pool. So do an I/O to fetch itE
-    ifstream inputFile(existingSSTPath(theLevel, theSSTNum), ios::binary);
-    if (!inputFile) {
+    // if we reach here, the page is not in buffer pool. So do an I/O to fetch
+    // it from the file kept open by the table cache, prefetching the pages
+    // ahead of a sequential reader
+    ReadaheadRange range = myReadahead.onRead(theLevel, theSSTNum, thePageNum);
+    if (range.numPages > 0) {
+        prefetch(theLevel, theSSTNum, range.firstPage, range.numPages);
+    }
 
+    shared_ptr<OpenFile> file = myTableCache.acquire(existingSSTPath(theLevel, theSSTNum));
+    if (!file) {
         throw runtime_error("Error when reading SSTs");
     }
 
-    vector<array<int, 2>> kvPairs;
-    char buffer[PAGE_SIZE];
+    // read the target page straight into a frame of the buffer pool, which
+    // is aligned for direct I/O. Direct I/O also needs the offset and length
+    // to be multiples of the block size; a short read at the end of the file
+    // is fine, and past its end there is no page.
+    off_t offset = (off_t) (thePageNum - 1) * PAGE_SIZE;
+    int fd = file->fd();
+    return bufferPool.loadPage(pageId, [fd, offset](char *theBuffer) {
+        return pread(fd, theBuffer, PAGE_SIZE, offset);
+    }, theHint);
+}
 
-    // calculate the position of the target page and seek to it
-    size_t offset = (thePageNum - 1) * PAGE_SIZE;
-    inputFile.seekg(offset, std::ios::beg);
+vector<PageHandle> LSMController::readPages(int theLevel, int theFirstPage, int theNumPages,
+                                            int theSSTNum, CacheHint theHint) {
+    shared_ptr<OpenFile> file = myTableCache.acquire(existingSSTPath(theLevel, theSSTNum));
+    struct stat fileStat;
+    if (!file || fstat(file->fd(), &fileStat) != 0) {
+        throw runtime_error("Error when reading SSTs");
+    }
 
-    // read the page
-    inputFile.read(buffer, sizeof(buffer));
-    streamsize bytesRead = inputFile.gcount();
+    // only the pages in the SST are read
+    int numPagesInSST = (fileStat.st_size + PAGE_SIZE - 1) / PAGE_SIZE;
+    int numPages = max(0, min(theNumPages, numPagesInSST - theFirstPage + 1));
+    vector<PageHandle> pages(numPages);
 
-    // no more data to read, return the empty pairs
-    if (bytesRead <= 0) {
-        return kvPairs;
+    if (myOptions.useMmapReads) {
+        KVSpan sst = mapSST(theLevel, theSSTNum, file);
+        if (!sst.empty()) {
+            for (int i = 0; i < numPages; i++) {
+                pages[i] = PageHandle(pageOf(sst, theFirstPage + i), file);
+            }
+            return pages;
+        }
     }
 
-    int numKVPairs = bytesRead / KVPAIR_SIZE;
-    vector<array<int, 2>> ioKVPairs(numKVPairs);
+    vector<int> missingPages;
+    for (int i = 0; i < numPages; i++) {
+        int pageNum = theFirstPage + i;
+        pages[i] = bufferPool.getPage(BufferPool::makeLeveledPageId(theLevel, theSSTNum, pageNum));
+        if (!pages[i].empty()) {
+            continue;
+        }
+        missingPages.push_back(i);
 
-    memcpy(ioKVPairs.data(), buffer, bytesRead);
-    kvPairs = ioKVPairs;
-    bufferPool.putPage(bufferPool.makeLeveledPageId(theLevel, theSSTNum, thePageNum), ioKVPairs);
+        // only the reads reaching the file move the readahead window
+        ReadaheadRange range = myReadahead.onRead(theLevel, theSSTNum, pageNum);
+        if (range.numPages > 0) {
+            prefetch(theLevel, theSSTNum, range.firstPage, range.numPages);
+        }
+    }
+    if (missingPages.empty()) {
+        return pages;
+    }
 
-    inputFile.close();
-    return kvPairs;
+    // aligned for direct I/O, one page per request
+    char *buffer;
+    if (posix_memalign((void **) &buffer, PAGE_SIZE, missingPages.size() * PAGE_SIZE) != 0) {
+        throw bad_alloc();
+    }
+    unique_ptr<char, decltype(&free)> ownedBuffer(buffer, &free);
+
+    vector<IORequest> requests;
+    for (size_t k = 0; k < missingPages.size(); k++) {
+        off_t offset = (off_t) (theFirstPage + missingPages[k] - 1) * PAGE_SIZE;
+        requests.push_back({IORequest::READ, file->fd(), buffer + k * PAGE_SIZE, PAGE_SIZE, offset,
+                            0});
+    }
+    myIOBackend->submitAndWait(requests);
+
+    for (size_t k = 0; k < missingPages.size(); k++) {
+        if (requests[k].result <= 0) {
+            throw runtime_error("Error when reading SSTs");
+        }
+
+        // copy the page into a frame of the buffer pool
+        int pageNum = theFirstPage + missingPages[k];
+        KVSpan ioKVPairs(reinterpret_cast<const array<int, 2> *>(requests[k].buffer),
+                         requests[k].result / KVPAIR_SIZE);
+        pages[missingPages[k]] = bufferPool.putPage(
+                BufferPool::makeLeveledPageId(theLevel, theSSTNum, pageNum), ioKVPairs, theHint);
+    }
+    return pages;
+}
+
+KVSpan LSMController::mapSST(int theLevel, int theSSTNum, shared_ptr<OpenFile> &theFile) {
+    theFile = myTableCache.acquire(existingSSTPath(theLevel, theSSTNum));
+    if (!theFile) {
+        throw runtime_error("Error when reading SSTs");
+    }
+
+    // lookups binary search the SST, touching its pages out of order
+    size_t size;
+    const char *mapping = theFile->map(MADV_RANDOM, size);
+    return KVSpan(reinterpret_cast<const array<int, 2> *>(mapping), size / KVPAIR_SIZE);
+}
+
+void LSMController::prefetch(int theLevel, int theSSTNum, int theFirstPage, int theNumPages) {
+    // direct reads bypass the page cache the hint would fill
+    shared_ptr<OpenFile> file = myTableCache.acquire(existingSSTPath(theLevel, theSSTNum));
+    if (!file || file->isDirect()) {
+        return;
+    }
+
+    // only a hint, so a failure leaves the reads to the disk
+    posix_fadvise(file->fd(), (off_t) (theFirstPage - 1) * PAGE_SIZE,
+                  (off_t) theNumPages * PAGE_SIZE, POSIX_FADV_WILLNEED);
+}
+
+void LSMController::forgetSST(int theLevel, int theSSTNum) {
+    bufferPool.invalidateSST(theLevel, theSSTNum);
+    myReadahead.forget(theLevel, theSSTNum);
+    myTableCache.evict(existingSSTPath(theLevel, theSSTNum));
 }
 
 pair<bool, int> LSMController::get(int theKey) {
+    optional<int> value = tryGet(theKey);
+    if (!value) {
+        // Target not found
+        return {false, -1};
+    }
+    return {true, *value};
+}
+
+optional<int> LSMController::tryGet(int theKey) {
     for (int level = 1; level <= myLevelMap.size(); level++) {
 
-        // skip the current level if it has no SST
-        if (myLevelMap[level] == 0) {
+        // skip the current level if it has no SST; find() keeps concurrent
+        // readers from inserting into the map
+        auto levelIt = myLevelMap.find(level);
+        if (levelIt == myLevelMap.end() || levelIt->second == 0) {
             continue;
         }
 
+        // a mapped SST is binary searched as a whole
+        if (myOptions.useMmapReads) {
+            shared_ptr<OpenFile> file;
+            KVSpan sst = mapSST(level, 1, file);
+            if (!sst.empty()) {
+                int result = searchSST(sst, theKey);
+                if (result != -1) {
+                    return sst[result][1];
+                }
+                continue;
+            }
+        }
+
         int pageNum = 1;
         while (true) {
-            const vector<array<int, 2>> &kvPairs = read(level, pageNum, 1);
+            PageHandle kvPairs = read(level, pageNum, 1);
             // if there's no more kvPairs, end inner loop and go to the next level
             if (kvPairs.empty()) {
                 break;
             }
 
-            int result = searchSST(kvPairs, theKey);
+            // search the page in place, it stays pinned until the next one
+            int result = searchSST(kvPairs.kvPairs(), theKey);
             if (result != -1) {
-                pair<bool, int> returnPair(true, kvPairs[result][1]);
-                return returnPair;
+                return kvPairs[result][1];
             }
             pageNum++;
         }
     }
 
     // Target not found if we reach here
-    pair<bool, int> returnPair(false, -1);
-    return returnPair;
+    return nullopt;
 }
 
 vector<array<int, 2>> LSMController::scan(int theLow, int theHigh) {
@@ -267,51 +479,56 @@ vector<array<int, 2>> LSMController::scan(int theLow, int theHigh) {
     vector<array<int, 2>> result;
 
     for (int level = 1; level <= myLevelMap.size(); level++) {
-        // skip the current level if it has no SST
-        if (myLevelMap[level] == 0) {
+        // skip the current level if it has no SST; find() keeps concurrent
+        // readers from inserting into the map
+        auto levelIt = myLevelMap.find(level);
+        if (levelIt == myLevelMap.end() || levelIt->second == 0) {
             continue;
         }
 
         int pageNum = 1;
         while (true) {
-            // there should only be 1 sst in each level
-            const vector<array<int, 2>> &kvPairs = read(level, pageNum, 1);
+            // there should only be 1 sst in each level. The pages of a scan
+            // are read once, so they would only flush the hot ones. They are
+            // read in batches, keeping the device busy with many pages
+            vector<PageHandle> batch =
+                readPages(level, pageNum, myOptions.ioQueueDepth, 1, CacheHint::DONT_CACHE);
             // if there's no more kvPairs, end inner loop and go to the next level
-            if (kvPairs.empty()) {
+            if (batch.empty()) {
                 break;
             }
+            pageNum += batch.size();
 
-            unsigned long size = kvPairs.size();
+            for (PageHandle &kvPairs: batch) {
+                unsigned long size = kvPairs.size();
 
-            // Skip the current SST if nothing is in range
-            if (kvPairs[0][0] > theHigh || kvPairs[size - 1][0] < theLow) {
-                pageNum++;
-                continue;
-            }
+                // Skip the current SST if nothing is in range
+                if (kvPairs[0][0] > theHigh || kvPairs[size - 1][0] < theLow) {
+                    continue;
+                }
 
-            // Do a binary search to find the smallest element in range.
-            // Note that it will not return -1 since we are already in range
-            int targetIdx = searchSSTSmallestLarger(kvPairs, theLow);
+                // Do a binary search to find the smallest element in range.
+                // Note that it will not return -1 since we are already in range
+                int targetIdx = searchSSTSmallestLarger(kvPairs.kvPairs(), theLow);
 
-            for (int j = targetIdx; j < size; j++) {
-                // skip the current SST if value exceeds theHigh
-                if (kvPairs[j][0] > theHigh) {
-                    break;
-                }
+                for (int j = targetIdx; j < size; j++) {
+                    // skip the current SST if value exceeds theHigh
+                    if (kvPairs[j][0] > theHigh) {
+                        break;
+                    }
 
-                // skip the current element if it is already added in previous
-                // iterations
-                if (lookupSet.find(kvPairs[j][0]) != lookupSet.end()) {
-                    continue;
-                }
+                    // skip the current element if it is already added in previous
+                    // iterations
+                    if (lookupSet.find(kvPairs[j][0]) != lookupSet.end()) {
+                        continue;
+                    }
 
-                // add the pair into result
-                result.push_back(kvPairs[j]);
-                // add key to lookupSet to prevent duplicates
-                lookupSet.insert(kvPairs[j][0]);
+                    // add the pair into result
+                    result.push_back(kvPairs[j]);
+                    // add key to lookupSet to prevent duplicates
+                    lookupSet.insert(kvPairs[j][0]);
+                }
             }
-
-            pageNum++;
         }
     }
 
@@ -324,115 +541,120 @@ vector<array<int, 2>> LSMController::scan(int theLow, int theHigh) {
     return result;
 }
 
-int LSMController::performCompaction() {
+bool LSMController::performCompaction(unordered_map<int, int> &theLevelMap,
+                                      vector<pair<int, int>> &theStaleSSTs) {
     int currentLevel = 1;
-    while (currentLevel <= myLevelMap.size()) {
+    while (currentLevel <= theLevelMap.size()) {
 
         // skip the current level if less than 2
-        if (myLevelMap[currentLevel] < 2) {
+        if (theLevelMap[currentLevel] < 2) {
             currentLevel++;
             continue;
         }
 
-        int pageNum = 1;
-        while (true) {
-            // read the 2 SSTs from the current level
-            const vector<array<int, 2>> &kvPairs_1 = read(currentLevel, pageNum, 1);
-            const vector<array<int, 2>> &kvPairs_2 = read(currentLevel, pageNum, 2);
+        // tombstones can be dropped when no older level exists below
+        bool isMaxLevel = currentLevel == theLevelMap.size();
 
-            // break the loop when no more data to be read from both SSTs
-            if (kvPairs_1.empty() && kvPairs_2.empty()) {
-                break;
-            }
+        // merge the 2 SSTs of the current level, where sst-2 is the newer one,
+        // and stream the result into a single SST in the next level
+        SSTIterator olderSST(*this, currentLevel, 1);
+        SSTIterator newerSST(*this, currentLevel, 2);
+        MergingIterator merged(newerSST, olderSST, isMaxLevel);
+        merged.seekToFirst();
 
-            // buffer for the output sst
-            vector<array<int, 2>> outputKVPairs;
-            int i = 0;
-            int j = 0;
-
-            while (i < kvPairs_1.size() && j < kvPairs_2.size()) {
-                // use the pair from memtable if the key equals
-                if (kvPairs_1[i][0] == kvPairs_2[j][0]) {
-                    // copy the value unless we are at the max level and encountered a tombstone
-                    if (!(currentLevel == myLevelMap.size() && kvPairs_2[j][1] == INT32_MIN)) {
-                        outputKVPairs.push_back(kvPairs_2[j]);
-                    }
-                    i++;
-                    j++;
-                } else if (kvPairs_1[i][0] < kvPairs_2[j][0]) {
-                    if (!(currentLevel == myLevelMap.size() && kvPairs_1[i][1] == INT32_MIN)) {
-                        outputKVPairs.push_back(kvPairs_1[i]);
-                    }
-                    i++;
-                } else {
-                    if (!(currentLevel == myLevelMap.size() && kvPairs_2[j][1] == INT32_MIN)) {
-                        outputKVPairs.push_back(kvPairs_2[j]);
-                    }
-                    j++;
-                }
-            }
+        // the merged SST is at most as large as both of them together
+        size_t numKVPairs = (filesystem::file_size(existingSSTPath(currentLevel, 1)) +
+                             filesystem::file_size(existingSSTPath(currentLevel, 2))) /
+                            KVPAIR_SIZE;
 
-            // add the remaining elements
-            while (i < kvPairs_1.size()) {
-                if (!(currentLevel == myLevelMap.size() && kvPairs_1[i][1] == INT32_MIN)) {
-                    outputKVPairs.push_back(kvPairs_1[i]);
-                }
-                i++;
-            }
+        if (!performSave(merged, theLevelMap, currentLevel + 1, myOptions.cacheCompactionOutput,
+                         numKVPairs)) {
+            return false;
+        }
 
-            while (j < kvPairs_2.size()) {
-                if (!(currentLevel == myLevelMap.size() && kvPairs_2[j][1] == INT32_MIN)) {
-                    outputKVPairs.push_back(kvPairs_2[j]);
-                }
-                j++;
-            }
+        // the old SSTs are removed once the metadata no longer points to
+        // them, so a crash never leaves it pointing to missing files. Only
+        // the merged SSTs are stale, the other levels stay cached.
+        theLevelMap[currentLevel] = 0;
+        theStaleSSTs.emplace_back(currentLevel, 1);
+        theStaleSSTs.emplace_back(currentLevel, 2);
 
-            // write into a new SST file in the next level
-            performSave(outputKVPairs, currentLevel + 1);
+        currentLevel++;
+    }
 
-            pageNum++;
-        }
+    return true;
+}
 
-        // remove the old SSTs
-        string path = existingSSTPath(currentLevel, 1);
-        if (remove(path.c_str()) != 0) {
-            throw runtime_error("Error when removing SSTs during compaction");
-        }
+LSMController::SSTIterator::SSTIterator(LSMController &theController,
+                                        int theLevel, int theSSTNum)
+        : myController(theController), myLevel(theLevel), mySSTNum(theSSTNum),
+          myPageNum(0), myBatchFirstPage(0), myIdx(0) {}
+
+void LSMController::SSTIterator::loadPage(int thePageNum) {
+    myPageNum = thePageNum;
+    // unpin the previous page first, so its frame can take the next one
+    myPage.release();
+    myIdx = 0;
+
+    int batchIdx = thePageNum - myBatchFirstPage;
+    if (batchIdx < 0 || batchIdx >= (int) myBatch.size()) {
+        // the merged SSTs are removed right after, so their pages are not
+        // cached
+        myBatch = myController.readPages(myLevel, thePageNum, myController.myOptions.ioQueueDepth,
+                                         mySSTNum, CacheHint::DONT_CACHE);
+        myBatchFirstPage = thePageNum;
+        batchIdx = 0;
+    }
 
-        path = existingSSTPath(currentLevel, 2);
-        if (remove(path.c_str()) != 0) {
-            throw runtime_error("Error when removing SSTs during compaction");
-        }
+    // an empty batch marks the end of the SST
+    if (!myBatch.empty()) {
+        myPage = std::move(myBatch[batchIdx]);
+    }
+}
 
-        // update the map
-        myLevelMap[currentLevel] = 0;
+void LSMController::SSTIterator::seekToFirst() { loadPage(1); }
 
-        currentLevel++;
+void LSMController::SSTIterator::seek(int theTarget) {
+    // skip the pages whose keys are all smaller than the target
+    loadPage(1);
+    while (!myPage.empty() && myPage.back()[0] < theTarget) {
+        loadPage(myPageNum + 1);
     }
 
-    return 0;
+    if (!myPage.empty()) {
+        myIdx = searchSSTSmallestLarger(myPage.kvPairs(), theTarget);
+    }
+}
+
+bool LSMController::SSTIterator::valid() { return myIdx < myPage.size(); }
+
+void LSMController::SSTIterator::next() {
+    myIdx++;
+    if (myIdx == myPage.size()) {
+        // an empty page marks the end of the SST
+        loadPage(myPageNum + 1);
+    }
 }
 
+int LSMController::SSTIterator::key() { return myPage[myIdx][0]; }
+
+int LSMController::SSTIterator::value() { return myPage[myIdx][1]; }
+
 string LSMController::buildPath(string theFilePath) {
     return myDbName + "/" + theFilePath;
 }
 
-string LSMController::newSSTPath(int theLevel) {
-    if (myLevelMap[theLevel] == SIZE_RATIO - 1) {
-        // level-{theLevel}/sst-2
-        return buildPath("level-" + to_string(theLevel) + "/" + SST_FILENAME_LSM + "2");
-    }
-
-    // level-{theLevel}/sst-1
-    return buildPath("level-" + to_string(theLevel) + "/" + SST_FILENAME_LSM + "1");
+int LSMController::newSSTNum(const unordered_map<int, int> &theLevelMap, int theLevel) {
+    // level-{theLevel}/sst-{1 or 2}
+    auto levelIt = theLevelMap.find(theLevel);
+    return levelIt != theLevelMap.end() && levelIt->second == SIZE_RATIO - 1 ? 2 : 1;
 }
 
 string LSMController::existingSSTPath(int theLevel, int theSSTNum) {
     return buildPath("level-" + to_string(theLevel) + "/" + SST_FILENAME_LSM + to_string(theSSTNum));
 }
 
-int LSMController::searchSST(const vector<array<int, 2>> &theKVPairs,
-                             int theTarget) {
+int LSMController::searchSST(KVSpan theKVPairs, int theTarget) {
     int lowIdx = 0;
     int highIdx = theKVPairs.size() - 1;
 
@@ -456,8 +678,7 @@ int LSMController::searchSST(const vector<array<int, 2>> &theKVPairs,
     return -1;
 }
 
-int LSMController::searchSSTSmallestLarger(
-        const vector<array<int, 2>> &theKVPairs, int theTarget) {
+int LSMController::searchSSTSmallestLarger(KVSpan theKVPairs, int theTarget) {
     int lowIdx = 0;
     int highIdx = theKVPairs.size() - 1;
     int resultIdx = -1;
@@ -486,18 +707,30 @@ int LSMController::searchSSTSmallestLarger(
 }
 
 bool LSMController::close() {
-    if (updateMetaData() == -1) {
+    cout << "Storing Metadata..." << endl;
+    if (updateMetaData(myLevelMap) == -1) {
         return false;
     }
+    cout << "Metadata Stored." << endl;
     return true;
 }
 
-int LSMController::invalidateBufferPool() {
-    int capacity = bufferPool.getCapacity();
-    bufferPool = BufferPool(capacity);
-    return 0;
-}
-
 unordered_map<int, int> LSMController::getMetadata() {
     return myLevelMap;
 }
+
+BufferPoolStats LSMController::getBufferPoolStats() {
+    return bufferPool.getStats();
+}
+
+vector<SSTCacheStats> LSMController::getSSTCacheStats() {
+    return bufferPool.getSSTStats();
+}
+
+void LSMController::resetBufferPoolStats() {
+    bufferPool.resetStats();
+}
+
+void LSMController::resizeBufferPool(int theCapacity) {
+    bufferPool.resize(theCapacity);
+}
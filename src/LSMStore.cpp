@@ -4,69 +4,328 @@
 
 #include "LSMStore.h"
 
-#include <cstring>
+#include <algorithm>
+#include <chrono>
 
-LSMStore::LSMStore(int memtableSize, string dBName, int bufferCapacity) {
+#include "SkipList.h"
+
+// the wait before retrying a failed flush, doubled after every failure
+const int FLUSH_RETRY_MIN_MS = 10;
+const int FLUSH_RETRY_MAX_MS = 1000;
+
+LSMStore::LSMStore(int memtableSize, string dBName, int bufferCapacity,
+                   LSMOptions options) {
     myMemtableSize = memtableSize;
-    myMemtable = make_shared<AVLTree>(memtableSize);
-    myLSMController = make_shared<LSMController>(dBName, bufferCapacity);
+    myOptions = options;
+    myOptions.maxImmutableMemtables = max(1, myOptions.maxImmutableMemtables);
+    myMemtable = newMemtable();
+    myLSMController = make_shared<LSMController>(dBName, bufferCapacity, myOptions);
+    myWAL = make_shared<WriteAheadLog>(dBName, myOptions.walSyncMode,
+                                       myOptions.walSyncIntervalMs);
+
+    myIsStopping = false;
+    myHasFlushFailed = false;
+    myFlushThread = thread(&LSMStore::flushMemtables, this);
+
+    recoverLog();
+}
+
+LSMStore::~LSMStore() { stopFlushThread(); }
+
+shared_ptr<Memtable> LSMStore::newMemtable() {
+    if (!myFreeMemtables.empty()) {
+        shared_ptr<Memtable> memtable = myFreeMemtables.back();
+        myFreeMemtables.pop_back();
+        return memtable;
+    }
+
+    if (myOptions.memtableType == MemtableType::SKIP_LIST) {
+        return make_shared<SkipList>(myMemtableSize);
+    }
+    return make_shared<AVLTree>(myMemtableSize);
+}
+
+void LSMStore::rotateMemtable(const shared_ptr<Memtable> &theMemtable) {
+    unique_lock<mutex> flushLock(myFlushMutex);
+
+    // stall the writers while the flush thread is behind
+    myFlushCondition.wait(flushLock, [this] {
+        return myImmutableMemtables.size() < (size_t) myOptions.maxImmutableMemtables;
+    });
+
+    unique_lock<shared_mutex> memtableLock(myMemtableMutex);
+    if (myMemtable != theMemtable || !myMemtable->isFull()) {
+        // another writer has already swapped the memtable
+        return;
+    }
+
+    myImmutableMemtables.push_back(myMemtable);
+    myMemtable = newMemtable();
+    myWAL->roll();
+    myFlushCondition.notify_all();
+}
+
+void LSMStore::recoverLog() {
+    auto start = chrono::steady_clock::now();
+    size_t numBytes;
+    vector<array<int, 2>> kvPairs = myWAL->recover(numBytes);
+    if (kvPairs.empty()) {
+        myWAL->removeRecoveredSegments();
+        return;
+    }
+    cout << "Replaying Write-Ahead Log..." << endl;
+    size_t numRecords = kvPairs.size();
+
+    // keep only the newest value of every key, which is the last one logged
+    stable_sort(kvPairs.begin(), kvPairs.end(),
+                [](const array<int, 2> &a, const array<int, 2> &b) {
+                    return a[0] < b[0];
+                });
+    size_t numUnique = 0;
+    for (size_t i = 0; i < kvPairs.size(); i++) {
+        if (i + 1 < kvPairs.size() && kvPairs[i + 1][0] == kvPairs[i][0]) {
+            continue;
+        }
+        kvPairs[numUnique++] = kvPairs[i];
+    }
+
+    // bulk build a memtable from each run of sorted pairs. The replayed
+    // pairs are logged again, so they survive another crash.
+    for (size_t begin = 0; begin < numUnique; begin += myMemtableSize) {
+        size_t count = min(numUnique - begin, (size_t) myMemtableSize);
+        shared_ptr<Memtable> memtable;
+        {
+            unique_lock<shared_mutex> memtableLock(myMemtableMutex);
+            memtable = myMemtable;
+            memtable->bulkLoad(&kvPairs[begin], count);
+            myWAL->append(&kvPairs[begin], count);
+        }
+
+        if (memtable->isFull()) {
+            rotateMemtable(memtable);
+        }
+    }
+
+    if (myWAL->sync()) {
+        myWAL->removeRecoveredSegments();
+    }
+
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    double megabytes = numBytes / (1024.0 * 1024.0);
+    cout << "Replayed " << numRecords << " records (" << megabytes << " MB) in "
+         << seconds << " s, " << megabytes / max(seconds, 1e-9) << " MB/s" << endl;
+}
+
+void LSMStore::flushMemtables() {
+    unique_lock<mutex> flushLock(myFlushMutex);
+    int retryMs = FLUSH_RETRY_MIN_MS;
+    while (true) {
+        myFlushCondition.wait(flushLock, [this] {
+            return !myImmutableMemtables.empty() || myIsStopping;
+        });
+        if (myImmutableMemtables.empty()) {
+            return;
+        }
+
+        // the memtable stays in the queue, and thus readable, until saved
+        shared_ptr<Memtable> memtable = myImmutableMemtables.front();
+        flushLock.unlock();
+
+        // stream the memtable into an SST on the first level by default. Only
+        // this thread changes the SSTs, and the controller lock is only taken
+        // to install them, so the readers keep going meanwhile.
+        unique_ptr<KVIterator> iterator = memtable->newIterator();
+        iterator->seekToFirst();
+        bool isSaved = myLSMController->save(*iterator, 1, myMemtableSize,
+                                             &myLSMControllerMutex);
+
+        flushLock.lock();
+        if (!isSaved) {
+            // the memtable stays at the front of the queue, readable and
+            // logged, and is saved again after a while. Its successors wait,
+            // as they must end up in newer SSTs.
+            cerr << "could not save memtable, retrying in " << retryMs << " ms" << endl;
+            myFlushCondition.wait_for(flushLock, chrono::milliseconds(retryMs),
+                                      [this] { return myIsStopping; });
+            retryMs = min(retryMs * 2, FLUSH_RETRY_MAX_MS);
+            if (myIsStopping) {
+                // give up, the logs of the unsaved memtables are replayed on
+                // the next open
+                myHasFlushFailed = true;
+                return;
+            }
+            continue;
+        }
+        retryMs = FLUSH_RETRY_MIN_MS;
+
+        // the log of a saved memtable is no longer needed
+        myWAL->releaseOldestSegment();
+
+        {
+            unique_lock<shared_mutex> memtableLock(myMemtableMutex);
+            myImmutableMemtables.pop_front();
+        }
+
+        // no reader can reach the memtable anymore, so recycle its arena
+        memtable->clear();
+        myFreeMemtables.push_back(memtable);
+        myFlushCondition.notify_all();
+    }
+}
+
+void LSMStore::stopFlushThread() {
+    if (!myFlushThread.joinable()) {
+        return;
+    }
+
+    {
+        lock_guard<mutex> flushLock(myFlushMutex);
+        myIsStopping = true;
+    }
+    myFlushCondition.notify_all();
+    myFlushThread.join();
 }
 
 void LSMStore::deleteDb() {
+    stopFlushThread();
+    myWAL->close();
     myLSMController->deleteFiles();
     myMemtable.reset();
 }
 
+BufferPoolStats LSMStore::getBufferPoolStats() {
+    // the counters are atomic, so the controller lock is enough to keep the
+    // pool alive
+    shared_lock<shared_mutex> controllerLock(myLSMControllerMutex);
+    return myLSMController->getBufferPoolStats();
+}
+
+vector<SSTCacheStats> LSMStore::getSSTCacheStats() {
+    shared_lock<shared_mutex> controllerLock(myLSMControllerMutex);
+    return myLSMController->getSSTCacheStats();
+}
+
+void LSMStore::resetBufferPoolStats() {
+    shared_lock<shared_mutex> controllerLock(myLSMControllerMutex);
+    myLSMController->resetBufferPoolStats();
+}
+
+void LSMStore::resizeBufferPool(int bufferCapacity) {
+    // the pool resizes itself safely, so readers keep going
+    shared_lock<shared_mutex> controllerLock(myLSMControllerMutex);
+    myLSMController->resizeBufferPool(bufferCapacity);
+}
+
 bool LSMStore::put(int key, int value) {
-    bool result = myMemtable->insert(key, value);
+    uint64_t seq = insert(key, value);
 
-    // flush data to SST if the memtable is full
-    if (result) {
-        const vector<array<int, 2>> &buffer = myMemtable->scan();
-        // save to the first level by default
-        bool isSaved = myLSMController->save(buffer, 1);
-        if (!isSaved) {
-            cerr << "could not save memtable" << endl;
-            return false;
+    // wait for the group commit outside of the memtable lock
+    return myWAL->commit(seq);
+}
+
+uint64_t LSMStore::insert(int key, int value) {
+    while (true) {
+        shared_ptr<Memtable> memtable;
+        bool isInserted;
+        bool isFull;
+        uint64_t seq = 0;
+        {
+            // the skip list takes concurrent writers, the AVL tree does not
+            shared_lock<shared_mutex> sharedLock(myMemtableMutex, defer_lock);
+            unique_lock<shared_mutex> uniqueLock(myMemtableMutex, defer_lock);
+            if (myOptions.memtableType == MemtableType::SKIP_LIST) {
+                sharedLock.lock();
+            } else {
+                uniqueLock.lock();
+            }
+
+            // puts of different keys stay concurrent, those of one key are
+            // applied and logged in the same order
+            unique_lock<mutex> keyLock;
+            if (myOptions.memtableType == MemtableType::SKIP_LIST) {
+                keyLock = unique_lock<mutex>(myKeyLocks[(uint32_t) key % NUM_KEY_LOCKS]);
+            }
+
+            memtable = myMemtable;
+            isInserted = memtable->tryInsert(key, value);
+            if (isInserted) {
+                seq = myWAL->append(key, value);
+            }
+            isFull = memtable->isFull();
         }
 
-        // clean the memtable by creating a new tree
-        myMemtable = make_shared<AVLTree>(myMemtableSize);
-        return true;
-    }
+        // hand the memtable to the flush thread once it is full
+        if (isFull) {
+            rotateMemtable(memtable);
+        }
 
-    return true;
+        if (isInserted) {
+            return seq;
+        }
+    }
 }
 
 int LSMStore::get(int key) {
-    int result;
+    optional<int> result = tryGet(key);
+    if (!result) {
+        throw std::runtime_error("Key not found");
+    }
+    return *result;
+}
 
-    try {
-        result = myMemtable->getValue(key);
-    } catch (const exception &e) {
-        // if not found in memtable, search the SSTs instead
-        if (strcmp(e.what(), "Key not found") == 0) {
-            const pair<bool, int> &pair = myLSMController->get(key);
+optional<int> LSMStore::tryGet(int key) {
+    optional<int> result;
 
-            if (pair.first) {
-                result = pair.second;
-            } else {
-                throw std::runtime_error("Key not found");
+    {
+        shared_lock<shared_mutex> memtableLock(myMemtableMutex);
+
+        // search the memtables from newest to oldest
+        vector<Memtable *> memtables = {myMemtable.get()};
+        for (auto it = myImmutableMemtables.rbegin();
+             it != myImmutableMemtables.rend(); it++) {
+            memtables.push_back(it->get());
+        }
+
+        for (Memtable *memtable: memtables) {
+            result = memtable->tryGet(key);
+            if (result) {
+                break;
             }
         }
     }
 
+    // if not found in memtable, search the SSTs instead
+    if (!result) {
+        shared_lock<shared_mutex> controllerLock(myLSMControllerMutex);
+        result = myLSMController->tryGet(key);
+    }
+
     // if it is a tombstone
-    if (result == INT32_MIN) {
-        throw std::runtime_error("Key not found");
+    if (result && *result == INT32_MIN) {
+        return nullopt;
     }
 
     return result;
 }
 
 vector<array<int, 2>> LSMStore::scan(int low, int high) {
-    const vector<array<int, 2>> &scanMem = myMemtable->scan(low, high);
-    const vector<array<int, 2>> &scanSST = myLSMController->scan(low, high);
+    vector<array<int, 2>> scanMem;
+    {
+        shared_lock<shared_mutex> memtableLock(myMemtableMutex);
+
+        // merge the memtables from newest to oldest
+        scanMem = myMemtable->scan(low, high);
+        for (auto it = myImmutableMemtables.rbegin();
+             it != myImmutableMemtables.rend(); it++) {
+            scanMem = mergeMemtableScans(scanMem, (*it)->scan(low, high));
+        }
+    }
+
+    vector<array<int, 2>> scanSST;
+    {
+        shared_lock<shared_mutex> controllerLock(myLSMControllerMutex);
+        scanSST = myLSMController->scan(low, high);
+    }
 
     // merge the results
     const vector<array<int, 2>> &results = mergeScanResults(scanMem, scanSST);
@@ -74,6 +333,20 @@ vector<array<int, 2>> LSMStore::scan(int low, int high) {
     return results;
 }
 
+vector<array<int, 2>> LSMStore::mergeMemtableScans(
+        const vector<array<int, 2>> &scanNewer,
+        const vector<array<int, 2>> &scanOlder) {
+    vector<array<int, 2>> result;
+    VectorIterator newer(scanNewer);
+    VectorIterator older(scanOlder);
+    MergingIterator merged(newer, older, false);
+
+    for (merged.seekToFirst(); merged.valid(); merged.next()) {
+        result.push_back({merged.key(), merged.value()});
+    }
+    return result;
+}
+
 vector<array<int, 2>> LSMStore::mergeScanResults(
         const vector<array<int, 2>> &scanMem,
         const vector<array<int, 2>> &scanSST) {
@@ -129,7 +402,25 @@ bool LSMStore::remove(int key) {
 bool LSMStore::close() {
     // store the memtable into SST
     cout << "Storing In-memory Data..." << endl;
-    bool isClosed = myLSMController->save(myMemtable->scan(), 1);
+    {
+        unique_lock<mutex> flushLock(myFlushMutex);
+        myFlushCondition.wait(flushLock, [this] {
+            return myImmutableMemtables.size() < (size_t) myOptions.maxImmutableMemtables;
+        });
+
+        unique_lock<shared_mutex> memtableLock(myMemtableMutex);
+        myImmutableMemtables.push_back(myMemtable);
+        myMemtable = newMemtable();
+        myWAL->roll();
+    }
+    myFlushCondition.notify_all();
+
+    // wait for the flush thread to save every memtable
+    stopFlushThread();
+
+    bool isLogClosed = myWAL->close();
+
+    unique_lock<shared_mutex> controllerLock(myLSMControllerMutex);
     myLSMController->close();
-    return isClosed;
+    return !myHasFlushFailed && isLogClosed;
 }
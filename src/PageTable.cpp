@@ -0,0 +1,169 @@
+#include "PageTable.h"
+
+// buddies are merged only when they fill at most half a bucket, so a page
+// evicted and another inserted do not split and merge the same bucket
+const int MERGE_THRESHOLD = PageTableBucket::SLOTS / 2;
+
+PageTable::PageTable() : globalDepth(0), numDeepestBuckets(1) {
+    directory.push_back(newBucket(0));
+}
+
+int PageTable::bucketOf(uint64_t hash) {
+    return directory[hash & ((1ULL << globalDepth) - 1)];
+}
+
+int PageTable::newBucket(int localDepth) {
+    int bucketIdx;
+    if (!freeBuckets.empty()) {
+        bucketIdx = freeBuckets.back();
+        freeBuckets.pop_back();
+    } else {
+        bucketIdx = buckets.size();
+        buckets.emplace_back();
+    }
+    buckets[bucketIdx].localDepth = localDepth;
+    buckets[bucketIdx].numSlotsUsed = 0;
+    return bucketIdx;
+}
+
+int PageTable::find(PageId pageId, uint64_t* numProbes) {
+    PageTableBucket& bucket = buckets[bucketOf(hashPageId(pageId))];
+    for (int i = 0; i < bucket.numSlotsUsed; i++) {
+        if (bucket.slots[i].pageId == pageId) {
+            if (numProbes != nullptr) {
+                *numProbes += i + 1;
+            }
+            return bucket.slots[i].frameIdx;
+        }
+    }
+    if (numProbes != nullptr) {
+        *numProbes += bucket.numSlotsUsed;
+    }
+    return -1;
+}
+
+void PageTable::insert(PageId pageId, int frameIdx) {
+    uint64_t hash = hashPageId(pageId);
+    while (true) {
+        PageTableBucket& bucket = buckets[bucketOf(hash)];
+        if (bucket.numSlotsUsed < PageTableBucket::SLOTS) {
+            bucket.slots[bucket.numSlotsUsed++] = {pageId, frameIdx};
+            return;
+        }
+        // the hash is a bijection, so distinct pages are told apart by some bit
+        splitBucket(bucketOf(hash));
+    }
+}
+
+void PageTable::splitBucket(int bucketIdx) {
+    int depth = buckets[bucketIdx].localDepth;
+    if (depth == globalDepth) {
+        // double the directory, both halves pointing to the same buckets
+        size_t size = directory.size();
+        directory.resize(2 * size);
+        for (size_t i = 0; i < size; i++) {
+            directory[size + i] = directory[i];
+        }
+        globalDepth++;
+        numDeepestBuckets = 0;
+    }
+
+    int siblingIdx = newBucket(depth + 1);
+    PageTableBucket& bucket = buckets[bucketIdx];
+    PageTableBucket& sibling = buckets[siblingIdx];
+    bucket.localDepth = depth + 1;
+    if (depth + 1 == globalDepth) {
+        numDeepestBuckets += 2;
+    }
+
+    // the pages with the next bit set move to the sibling
+    uint64_t lowBits = hashPageId(bucket.slots[0].pageId) & ((1ULL << depth) - 1);
+    int numKept = 0;
+    for (int i = 0; i < bucket.numSlotsUsed; i++) {
+        if ((hashPageId(bucket.slots[i].pageId) >> depth) & 1) {
+            sibling.slots[sibling.numSlotsUsed++] = bucket.slots[i];
+        } else {
+            bucket.slots[numKept++] = bucket.slots[i];
+        }
+    }
+    bucket.numSlotsUsed = numKept;
+
+    // the entries of the bucket with the next bit set now point to the sibling
+    for (size_t i = lowBits | (1ULL << depth); i < directory.size(); i += 2ULL << depth) {
+        directory[i] = siblingIdx;
+    }
+}
+
+void PageTable::erase(PageId pageId) {
+    uint64_t hash = hashPageId(pageId);
+    PageTableBucket& bucket = buckets[bucketOf(hash)];
+    for (int i = 0; i < bucket.numSlotsUsed; i++) {
+        if (bucket.slots[i].pageId == pageId) {
+            bucket.slots[i] = bucket.slots[--bucket.numSlotsUsed];
+            break;
+        }
+    }
+
+    mergeBucket(hash);
+}
+
+void PageTable::mergeBucket(uint64_t hash) {
+    while (true) {
+        int bucketIdx = bucketOf(hash);
+        int depth = buckets[bucketIdx].localDepth;
+        if (depth == 0) {
+            return;
+        }
+
+        // the buddy differs in the last bit indexing the bucket
+        uint64_t dirIdx = hash & ((1ULL << depth) - 1);
+        uint64_t buddyBit = 1ULL << (depth - 1);
+        int buddyIdx = directory[dirIdx ^ buddyBit];
+        if (buckets[buddyIdx].localDepth != depth ||
+            buckets[bucketIdx].numSlotsUsed + buckets[buddyIdx].numSlotsUsed > MERGE_THRESHOLD) {
+            return;
+        }
+
+        // keep the bucket without the bit set
+        int keptIdx = dirIdx & buddyBit ? buddyIdx : bucketIdx;
+        int mergedIdx = keptIdx == bucketIdx ? buddyIdx : bucketIdx;
+        PageTableBucket& kept = buckets[keptIdx];
+        PageTableBucket& merged = buckets[mergedIdx];
+        for (int i = 0; i < merged.numSlotsUsed; i++) {
+            kept.slots[kept.numSlotsUsed++] = merged.slots[i];
+        }
+        kept.localDepth = depth - 1;
+        merged.localDepth = -1;  // unused
+        merged.numSlotsUsed = 0;
+        freeBuckets.push_back(mergedIdx);
+        if (depth == globalDepth) {
+            numDeepestBuckets -= 2;
+        }
+
+        for (size_t i = dirIdx & (buddyBit - 1); i < directory.size(); i += buddyBit) {
+            directory[i] = keptIdx;
+        }
+        shrinkDirectory();
+    }
+}
+
+void PageTable::shrinkDirectory() {
+    while (globalDepth > 0 && numDeepestBuckets == 0) {
+        // both halves point to the same buckets
+        globalDepth--;
+        directory.resize(directory.size() / 2);
+
+        numDeepestBuckets = 0;
+        for (const PageTableBucket& bucket : buckets) {
+            numDeepestBuckets += bucket.localDepth == globalDepth;
+        }
+    }
+}
+
+int PageTable::getGlobalDepth() {
+    return globalDepth;
+}
+
+int PageTable::getNumBuckets() {
+    return buckets.size() - freeBuckets.size();
+}
@@ -0,0 +1,60 @@
+//
+// Detects sequential reads of SST pages to prefetch the pages ahead of them
+//
+
+#include "Readahead.h"
+
+#include <algorithm>
+
+// the first window, enough to hide the latency of a few reads
+const int MIN_READAHEAD_PAGES = 4;
+
+Readahead::Readahead(int theMaxWindowPages)
+        : myMinWindowPages(min(MIN_READAHEAD_PAGES, max(theMaxWindowPages, 0))),
+          myMaxWindowPages(max(theMaxWindowPages, 0)) {}
+
+uint32_t Readahead::streamKey(int theLevel, int theSSTNum) {
+    return ((uint32_t) (uint16_t) theLevel << 16) | (uint16_t) theSSTNum;
+}
+
+ReadaheadRange Readahead::onRead(int theLevel, int theSSTNum, int thePageNum) {
+    if (myMaxWindowPages == 0) {
+        return {0, 0};
+    }
+
+    lock_guard<mutex> lock(myMutex);
+    auto it = myStreams.find(streamKey(theLevel, theSSTNum));
+    bool isSequential = it != myStreams.end() && it->second.nextPage == thePageNum;
+
+    // scans and compactions read an SST from its first page, so that read
+    // starts a stream right away
+    if (!isSequential && thePageNum != 1) {
+        myStreams[streamKey(theLevel, theSSTNum)] = {thePageNum + 1, thePageNum + 1,
+                                                    myMinWindowPages};
+        return {0, 0};
+    }
+
+    if (!isSequential) {
+        Stream stream = {thePageNum + 1, thePageNum + 1 + myMinWindowPages, myMinWindowPages};
+        myStreams[streamKey(theLevel, theSSTNum)] = stream;
+        return {thePageNum + 1, myMinWindowPages};
+    }
+
+    Stream &stream = it->second;
+    stream.nextPage = thePageNum + 1;
+
+    // wait until the reader is halfway through the prefetched window
+    if (stream.prefetchedUntil - thePageNum > stream.windowPages / 2) {
+        return {0, 0};
+    }
+
+    stream.windowPages = min(stream.windowPages * 2, myMaxWindowPages);
+    ReadaheadRange range = {max(stream.prefetchedUntil, thePageNum + 1), stream.windowPages};
+    stream.prefetchedUntil = range.firstPage + range.numPages;
+    return range;
+}
+
+void Readahead::forget(int theLevel, int theSSTNum) {
+    lock_guard<mutex> lock(myMutex);
+    myStreams.erase(streamKey(theLevel, theSSTNum));
+}
@@ -5,6 +5,7 @@
 #include "SSTController.h"
 
 #include <fcntl.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <unistd.h>
 
@@ -16,14 +17,19 @@
 
 #include "BufferPool.h"
 #include "Constants.h"
+#include "SSTWriter.h"
 
 namespace fs = std::filesystem;
 
 string METADATA_FILENAME = "metadata";
 string SST_FILENAME = "sst-";
 
-SSTController::SSTController(string theDbName, int bufferPoolCapacity)
-    : bufferPool(bufferPoolCapacity), myDbName(std::move(theDbName)) {
+SSTController::SSTController(string theDbName, int bufferPoolCapacity,
+                             int theMaxOpenFiles, bool theUseMmapReads)
+    : bufferPool(bufferPoolCapacity),
+      myTableCache(theMaxOpenFiles),
+      myUseMmapReads(theUseMmapReads),
+      myDbName(std::move(theDbName)) {
     // Step 1: create the directory and metadata if not exist
     if (mkdir(myDbName.c_str(), 0777) == 0) {
         myNumSST = 0;
@@ -36,6 +42,7 @@ SSTController::SSTController(string theDbName, int bufferPoolCapacity)
 }
 
 void SSTController::deleteFiles() {
+    myTableCache.clear();
     try {
         if (fs::exists(myDbName)) {
             fs::remove_all(myDbName);
@@ -83,21 +90,32 @@ int SSTController::readMetaData() {
 bool SSTController::save(vector<array<int, 2>> theKVPairs) {
     if (theKVPairs.empty()) return true;
 
-    ofstream outputFile(newSSTPath());
-
-    if (!outputFile) {
+    int fd = open(newSSTPath().c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if (fd < 0) {
         return false;
     }
 
-    outputFile.write(reinterpret_cast<const char *>(theKVPairs.data()),
-                     theKVPairs.size() * sizeof(array<int, 2>));
+    // stream the KV-pairs page by page through the write buffer
+    SSTWriter writer(fd, false);
+    writer.preallocate(theKVPairs.size());
+    size_t numKVPairsInPage = PAGE_SIZE / KVPAIR_SIZE;
+    for (size_t first = 0; first < theKVPairs.size(); first += numKVPairsInPage) {
+        array<int, 2> *page = writer.nextPage();
+        if (page == nullptr) {
+            close(fd);
+            return false;
+        }
+        size_t numKVPairs = min(numKVPairsInPage, theKVPairs.size() - first);
+        copy_n(theKVPairs.begin() + first, numKVPairs, page);
+        writer.addPage(numKVPairs);
+    }
 
-    if (outputFile.fail()) {
+    bool isWritten = writer.finish();
+    close(fd);
+    if (!isWritten) {
         return false;
     }
 
-    outputFile.close();
-
     // update the metadata
     myNumSST++;
     updateMetaData();
@@ -106,19 +124,17 @@ bool SSTController::save(vector<array<int, 2>> theKVPairs) {
 }
 
 vector<array<int, 2>> SSTController::readSST(int theSSTIdx) {
-    std::string path = existingSSTPath(theSSTIdx);
-    const char *sstPath = path.c_str();
-    int fd = open(sstPath, O_RDONLY);
-    if (fd < 0) {
+    // the file stays in the table cache for the page reads below
+    shared_ptr<OpenFile> file = myTableCache.acquire(existingSSTPath(theSSTIdx));
+    if (!file) {
         throw runtime_error("Error opening file for direct I/O");
     }
 
     // get the file size using fstat
     struct stat fileStat;
-    if (fstat(fd, &fileStat) < 0) {
+    if (fstat(file->fd(), &fileStat) < 0) {
         std::cerr << "Error getting file size: " << strerror(errno)
                   << std::endl;
-        close(fd);
         throw runtime_error("Error getting file size");
     }
     size_t fileSize = fileStat.st_size;
@@ -136,7 +152,7 @@ vector<array<int, 2>> SSTController::readSST(int theSSTIdx) {
         }
 
         // check buffer pool for page first
-        vector<array<int, 2>> pageKVPairs = readSSTPage(theSSTIdx, pageNum);
+        PageHandle pageKVPairs = readSSTPage(theSSTIdx, pageNum);
 
         // add the KVPairs from the page to allKVPairs
         allKVPairs.insert(allKVPairs.end(), pageKVPairs.begin(),
@@ -144,68 +160,106 @@ vector<array<int, 2>> SSTController::readSST(int theSSTIdx) {
         pageNum++;
     }
 
-    close(fd);
     return allKVPairs;
 }
 
-vector<array<int, 2>> SSTController::readSSTPage(int sstIdx, int page) {
+PageHandle SSTController::readSSTPage(int sstIdx, int page) {
+    if (myUseMmapReads) {
+        shared_ptr<OpenFile> file;
+        KVSpan sst = mapSST(sstIdx, file);
+        if (!sst.empty()) {
+            size_t first = min((size_t)page * (PAGE_SIZE / KVPAIR_SIZE), sst.size());
+            size_t numKVPairs = min((size_t)(PAGE_SIZE / KVPAIR_SIZE), sst.size() - first);
+            return PageHandle(KVSpan(sst.data() + first, numKVPairs), file);
+        }
+        // otherwise read the page through the buffer pool
+    }
+
     // check buffer pool for page first
-    vector<array<int, 2>> pageKVPairs = bufferPool.getPage(bufferPool.makePageId(sstIdx, page));
+    PageHandle pageKVPairs = bufferPool.getPage(BufferPool::makePageId(sstIdx, page));
 
     if (pageKVPairs.empty()) {
         // page not in buffer pool, so do an I/O and add the page to buffer
 
-        // open the SST file
-        std::string path = existingSSTPath(sstIdx);
-        const char *sstPath = path.c_str();
-        int fd = open(sstPath, O_RDONLY);
-        if (fd < 0) {
+        // the SST file is kept open by the table cache
+        shared_ptr<OpenFile> file = myTableCache.acquire(existingSSTPath(sstIdx));
+        if (!file) {
             throw runtime_error("Error opening file for direct I/O");
         }
 
-        char *buffer = nullptr;
-        if (posix_memalign((void **)&buffer, 512, PAGE_SIZE) != 0) {
-            close(fd);
-            throw runtime_error("Memory allocation failed for page read");
-        }
-
-        int offset = page * PAGE_SIZE;
-        ssize_t result = pread(fd, buffer, PAGE_SIZE, offset);
+        // read the page straight into a frame of the buffer pool
+        off_t offset = (off_t)page * PAGE_SIZE;
+        int fd = file->fd();
+        pageKVPairs = bufferPool.loadPage(
+            BufferPool::makePageId(sstIdx, page),
+            [fd, offset](char *buffer) { return pread(fd, buffer, PAGE_SIZE, offset); });
 
-        if (result <= 0) {
-            free(buffer);
-            close(fd);
+        if (pageKVPairs.empty()) {
             throw runtime_error("Error reading SST page");
         }
+    }
 
-        vector<array<int, 2>> kVPairs(result / KVPAIR_SIZE);
-        memcpy(kVPairs.data(), buffer, result);
-        pageKVPairs = kVPairs;
+    return pageKVPairs;
+}
 
-        free(buffer);
-        close(fd);
+BufferPool &SSTController::getBufferPool() {
+    return bufferPool;
+}
 
-        // add the page to buffer pool
-        bufferPool.putPage(bufferPool.makePageId(sstIdx, page), pageKVPairs);
+TableCache &SSTController::getTableCache() {
+    return myTableCache;
+}
+
+KVSpan SSTController::mapSST(int theSSTIdx, shared_ptr<OpenFile> &theFile) {
+    theFile = myTableCache.acquire(existingSSTPath(theSSTIdx));
+    if (!theFile) {
+        throw runtime_error("Error opening SST file for mapping");
     }
 
-    return pageKVPairs;
+    // lookups land on random pages of the SST
+    size_t size;
+    const char *mapping = theFile->map(MADV_RANDOM, size);
+    return KVSpan(reinterpret_cast<const array<int, 2> *>(mapping), size / KVPAIR_SIZE);
+}
+
+bool SSTController::isUsingMmapReads() const {
+    return myUseMmapReads;
 }
 
 pair<bool, int> SSTController::get(int theKey) {
+    optional<int> value = tryGet(theKey);
+    if (!value) {
+        // Target not found
+        return {false, -1};
+    }
+    return {true, *value};
+}
+
+optional<int> SSTController::tryGet(int theKey) {
     for (int i = myNumSST; i > 0; i--) {
+        // a mapped SST is binary searched in place
+        if (myUseMmapReads) {
+            shared_ptr<OpenFile> file;
+            KVSpan sst = mapSST(i, file);
+            if (!sst.empty()) {
+                int result = searchSST(sst, theKey);
+                if (result != -1) {
+                    return sst[result][1];
+                }
+                continue;
+            }
+        }
+
         const vector<array<int, 2>> &sst = readSST(i);
         int result = searchSST(sst, theKey);
 
         if (result != -1) {
-            pair<bool, int> returnPair(true, sst[result][1]);
-            return returnPair;
+            return sst[result][1];
         }
     }
 
     // Target not found if we reach here
-    pair<bool, int> returnPair(false, -1);
-    return returnPair;
+    return nullopt;
 }
 
 vector<array<int, 2>> SSTController::scan(int theLow, int theHigh) {
@@ -269,8 +323,7 @@ string SSTController::existingSSTPath(int theSSTIdx) {
     return buildPath(SST_FILENAME + to_string(theSSTIdx));
 }
 
-int SSTController::searchSST(const vector<array<int, 2>> &theKVPairs,
-                             int theTarget) {
+int SSTController::searchSST(KVSpan theKVPairs, int theTarget) {
     int lowIdx = 0;
     int highIdx = theKVPairs.size() - 1;
 
@@ -294,8 +347,8 @@ int SSTController::searchSST(const vector<array<int, 2>> &theKVPairs,
     return -1;
 }
 
-int SSTController::searchSSTSmallestLarger(
-    const vector<array<int, 2>> &theKVPairs, int theTarget) {
+int SSTController::searchSSTSmallestLarger(KVSpan theKVPairs,
+                                           int theTarget) {
     int lowIdx = 0;
     int highIdx = theKVPairs.size() - 1;
     int resultIdx = -1;
@@ -0,0 +1,117 @@
+//
+// Streams the pages of a new SST to its file
+//
+
+#include "SSTWriter.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+#include "Constants.h"
+
+SSTWriter::SSTWriter(int theFd, bool theIsDirect, size_t theBufferSize)
+        : myFd(theFd), myIsDirect(theIsDirect), myBuffer(nullptr), myNumBufferedBytes(0),
+          myBufferOffset(0), mySize(0) {
+    myBufferSize = max((theBufferSize + PAGE_SIZE - 1) / PAGE_SIZE, (size_t) 1) * PAGE_SIZE;
+
+    // aligned for direct I/O
+    if (posix_memalign((void **) &myBuffer, PAGE_SIZE, myBufferSize) != 0) {
+        throw runtime_error("Memory allocation failed for SST write buffer");
+    }
+}
+
+SSTWriter::~SSTWriter() {
+    free(myBuffer);
+}
+
+void SSTWriter::preallocate(size_t theNumKVPairs) {
+    size_t numBytes = (theNumKVPairs * KVPAIR_SIZE + PAGE_SIZE - 1) / PAGE_SIZE * PAGE_SIZE;
+    if (numBytes == 0) {
+        return;
+    }
+#ifdef FALLOC_FL_KEEP_SIZE
+    // only an optimization, so file systems without fallocate are fine
+    fallocate(myFd, FALLOC_FL_KEEP_SIZE, 0, numBytes);
+#endif
+}
+
+array<int, 2> *SSTWriter::nextPage() {
+    if (myNumBufferedBytes + PAGE_SIZE > myBufferSize && !flushBuffer()) {
+        return nullptr;
+    }
+    return reinterpret_cast<array<int, 2> *>(myBuffer + myNumBufferedBytes);
+}
+
+void SSTWriter::addPage(size_t theNumKVPairs) {
+    size_t numBytes = theNumKVPairs * KVPAIR_SIZE;
+    mySize += numBytes;
+
+    // a direct write covers whole pages, so the last page is padded and the
+    // file truncated to the KV-pairs by finish()
+    if (myIsDirect && numBytes < PAGE_SIZE) {
+        memset(myBuffer + myNumBufferedBytes + numBytes, 0, PAGE_SIZE - numBytes);
+        numBytes = PAGE_SIZE;
+    }
+    myNumBufferedBytes += numBytes;
+}
+
+bool SSTWriter::flushBuffer() {
+    size_t numWritten = 0;
+    while (numWritten < myNumBufferedBytes) {
+        ssize_t result = pwrite(myFd, myBuffer + numWritten, myNumBufferedBytes - numWritten,
+                                myBufferOffset + numWritten);
+        if (result < 0 && errno == EINTR) {
+            continue;
+        }
+        if (result <= 0) {
+            int error = result < 0 ? errno : EIO;
+            std::cerr << "Error writing data: " << strerror(error)
+                      << " (errno: " << error << ")" << std::endl;
+            return false;
+        }
+        numWritten += result;
+    }
+
+#ifdef SYNC_FILE_RANGE_WRITE
+    // start the writeback of the range without waiting for it, so the dirty
+    // pages of a large SST do not pile up until the final sync
+    if (numWritten > 0) {
+        sync_file_range(myFd, myBufferOffset, numWritten, SYNC_FILE_RANGE_WRITE);
+    }
+#endif
+
+    myBufferOffset += numWritten;
+    myNumBufferedBytes = 0;
+    return true;
+}
+
+bool SSTWriter::finish() {
+    if (!flushBuffer()) {
+        return false;
+    }
+
+    // drops the padding of a direct write, and the blocks preallocated past
+    // the KV-pairs
+    if (ftruncate(myFd, mySize) != 0) {
+        std::cerr << "Error truncating SST: " << strerror(errno) << std::endl;
+        return false;
+    }
+
+    // the SST must be on disk before the metadata points to it
+    if (fdatasync(myFd) != 0) {
+        std::cerr << "Error syncing SST: " << strerror(errno) << std::endl;
+        return false;
+    }
+    return true;
+}
+
+off_t SSTWriter::size() const {
+    return mySize;
+}
@@ -0,0 +1,234 @@
+#include "SkipList.h"
+
+#include <algorithm>
+#include <functional>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+
+using namespace std;
+
+SkipList::SkipList(int capacity)
+        : myCapacity(capacity), mySize(0), myNumNodes(1),
+          myNodes(new SkipListNode[capacity + 1]) {
+    SkipListNode &head = myNodes[HEAD];
+    head.key = 0;
+    head.value.store(0, memory_order_relaxed);
+    head.height = SKIP_LIST_MAX_HEIGHT;
+    for (auto &next: head.next) {
+        next.store(NIL, memory_order_relaxed);
+    }
+}
+
+uint32_t SkipList::allocateNode(int key, int value, int height) {
+    // every accepted insert owns at most one node, so this stays in the arena
+    uint32_t idx = myNumNodes.fetch_add(1, memory_order_relaxed);
+
+    SkipListNode &node = myNodes[idx];
+    node.key = key;
+    node.value.store(value, memory_order_relaxed);
+    node.height = height;
+    return idx;
+}
+
+int SkipList::randomHeight() {
+    // xorshift generator per thread, so concurrent inserts do not contend
+    thread_local uint32_t state = 0x9E3779B9u ^ (uint32_t) hash<thread::id>{}(this_thread::get_id());
+
+    int height = 1;
+    while (height < SKIP_LIST_MAX_HEIGHT) {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        // grow with a probability of 1/4
+        if ((state & 3) != 0) {
+            break;
+        }
+        height++;
+    }
+    return height;
+}
+
+bool SkipList::findNode(int key, uint32_t *thePreds, uint32_t *theSuccs) {
+    uint32_t pred = HEAD;
+    for (int level = SKIP_LIST_MAX_HEIGHT - 1; level >= 0; level--) {
+        uint32_t curr = myNodes[pred].next[level].load(memory_order_acquire);
+        while (curr != NIL && myNodes[curr].key < key) {
+            pred = curr;
+            curr = myNodes[curr].next[level].load(memory_order_acquire);
+        }
+        thePreds[level] = pred;
+        theSuccs[level] = curr;
+    }
+
+    return theSuccs[0] != NIL && myNodes[theSuccs[0]].key == key;
+}
+
+uint32_t SkipList::findGreaterOrEqual(int key) {
+    uint32_t pred = HEAD;
+    uint32_t curr = NIL;
+    for (int level = SKIP_LIST_MAX_HEIGHT - 1; level >= 0; level--) {
+        curr = myNodes[pred].next[level].load(memory_order_acquire);
+        while (curr != NIL && myNodes[curr].key < key) {
+            pred = curr;
+            curr = myNodes[curr].next[level].load(memory_order_acquire);
+        }
+    }
+    return curr;
+}
+
+bool SkipList::insert(int key, int value) {
+    if (!tryInsert(key, value)) {
+        cout << "Cannot insert, skip list is full!" << endl;
+        return true;
+    }
+    return isFull();
+}
+
+bool SkipList::tryInsert(int key, int value) {
+    // reserve a slot first so the arena can never overflow
+    int slot = mySize.fetch_add(1, memory_order_relaxed);
+    if (slot >= myCapacity) {
+        mySize.fetch_sub(1, memory_order_relaxed);
+        return false;
+    }
+
+    uint32_t preds[SKIP_LIST_MAX_HEIGHT];
+    uint32_t succs[SKIP_LIST_MAX_HEIGHT];
+    uint32_t nodeIdx = NIL;
+
+    while (true) {
+        if (findNode(key, preds, succs)) {
+            // the key exists already, so just overwrite its value
+            myNodes[succs[0]].value.store(value, memory_order_release);
+            return true;
+        }
+
+        if (nodeIdx == NIL) {
+            nodeIdx = allocateNode(key, value, randomHeight());
+        }
+        SkipListNode &node = myNodes[nodeIdx];
+        for (int level = 0; level < node.height; level++) {
+            node.next[level].store(succs[level], memory_order_relaxed);
+        }
+
+        // linking the bottom level makes the node visible to readers
+        uint32_t expected = succs[0];
+        if (myNodes[preds[0]].next[0].compare_exchange_strong(
+                expected, nodeIdx, memory_order_release, memory_order_relaxed)) {
+            break;
+        }
+        // another writer changed the bottom level, search again
+    }
+
+    // link the upper levels, which only speed up searches
+    SkipListNode &node = myNodes[nodeIdx];
+    for (int level = 1; level < node.height; level++) {
+        while (true) {
+            uint32_t expected = succs[level];
+            if (myNodes[preds[level]].next[level].compare_exchange_strong(
+                    expected, nodeIdx, memory_order_release, memory_order_relaxed)) {
+                break;
+            }
+            findNode(key, preds, succs);
+            node.next[level].store(succs[level], memory_order_relaxed);
+        }
+    }
+
+    return true;
+}
+
+int SkipList::getValue(int key) {
+    optional<int> value = tryGet(key);
+    if (!value) {
+        throw std::runtime_error("Key not found");
+    }
+    return *value;
+}
+
+optional<int> SkipList::tryGet(int key) {
+    uint32_t node = findGreaterOrEqual(key);
+    if (node == NIL || myNodes[node].key != key) {
+        return nullopt;
+    }
+    return myNodes[node].value.load(memory_order_acquire);
+}
+
+vector<array<int, 2>> SkipList::scan(int low, int high) {
+    vector<array<int, 2>> result;
+    Iterator it(*this);
+
+    for (it.seek(low); it.valid() && it.key() <= high; it.next()) {
+        result.push_back({it.key(), it.value()});
+    }
+    return result;
+}
+
+vector<array<int, 2>> SkipList::scan() {
+    vector<array<int, 2>> result;
+    result.reserve(getSize());
+    Iterator it(*this);
+
+    for (it.seekToFirst(); it.valid(); it.next()) {
+        result.push_back({it.key(), it.value()});
+    }
+    return result;
+}
+
+unique_ptr<KVIterator> SkipList::newIterator() {
+    return make_unique<Iterator>(*this);
+}
+
+SkipList::Iterator::Iterator(SkipList &theList) : myList(theList), myNode(NIL) {}
+
+void SkipList::Iterator::seekToFirst() {
+    myNode = myList.myNodes[HEAD].next[0].load(memory_order_acquire);
+}
+
+void SkipList::Iterator::seek(int theTarget) {
+    myNode = myList.findGreaterOrEqual(theTarget);
+}
+
+bool SkipList::Iterator::valid() { return myNode != NIL; }
+
+void SkipList::Iterator::next() {
+    myNode = myList.myNodes[myNode].next[0].load(memory_order_acquire);
+}
+
+int SkipList::Iterator::key() { return myList.myNodes[myNode].key; }
+
+int SkipList::Iterator::value() {
+    return myList.myNodes[myNode].value.load(memory_order_acquire);
+}
+
+void SkipList::bulkLoad(const array<int, 2> *kvPairs, size_t count) {
+    uint32_t tails[SKIP_LIST_MAX_HEIGHT];
+    fill(begin(tails), end(tails), HEAD);
+
+    for (size_t i = 0; i < count; i++) {
+        int height = randomHeight();
+        uint32_t node = allocateNode(kvPairs[i][0], kvPairs[i][1], height);
+        for (int level = 0; level < height; level++) {
+            myNodes[node].next[level].store(NIL, memory_order_relaxed);
+            myNodes[tails[level]].next[level].store(node, memory_order_relaxed);
+            tails[level] = node;
+        }
+    }
+
+    // publish the nodes to the readers of the other threads
+    mySize.store((int) count, memory_order_release);
+}
+
+void SkipList::clear() {
+    for (auto &next: myNodes[HEAD].next) {
+        next.store(NIL, memory_order_relaxed);
+    }
+    myNumNodes.store(1, memory_order_relaxed);
+    mySize.store(0, memory_order_release);
+}
+
+bool SkipList::isConcurrent() { return true; }
+
+bool SkipList::isFull() { return mySize.load(memory_order_relaxed) >= myCapacity; }
+
+int SkipList::getSize() { return min(mySize.load(memory_order_relaxed), myCapacity); }
@@ -0,0 +1,114 @@
+//
+// Keeps the files of SSTs and their indexes open between reads
+//
+
+#include "TableCache.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+
+int openFile(const string &thePath, int theFlags, bool theUseDirectIO, bool &theIsDirect,
+             mode_t theMode) {
+    theIsDirect = false;
+#ifdef O_DIRECT
+    if (theUseDirectIO) {
+        int fd = open(thePath.c_str(), theFlags | O_DIRECT, theMode);
+        // file systems without direct I/O, e.g. tmpfs, reject the flag
+        if (fd >= 0 || errno != EINVAL) {
+            theIsDirect = fd >= 0;
+            return fd;
+        }
+    }
+#endif
+    return open(thePath.c_str(), theFlags, theMode);
+}
+
+OpenFile::OpenFile(int theFd, bool theIsDirect)
+        : myFd(theFd), myMapping(nullptr), myMappedSize(0), myIsMapped(false),
+          myIsDirect(theIsDirect) {}
+
+OpenFile::~OpenFile() {
+    if (myMapping != nullptr) {
+        munmap(const_cast<char *>(myMapping), myMappedSize);
+    }
+    close(myFd);
+}
+
+const char *OpenFile::map(int theAdvice, size_t &theSize) {
+    lock_guard<mutex> lock(myMappingMutex);
+    if (!myIsMapped) {
+        myIsMapped = true;
+        struct stat fileStat;
+        if (fstat(myFd, &fileStat) == 0 && fileStat.st_size > 0) {
+            void *mapping = mmap(nullptr, fileStat.st_size, PROT_READ, MAP_SHARED, myFd, 0);
+            if (mapping != MAP_FAILED) {
+                madvise(mapping, fileStat.st_size, theAdvice);
+                myMapping = static_cast<const char *>(mapping);
+                myMappedSize = fileStat.st_size;
+            }
+        }
+    }
+    theSize = myMappedSize;
+    return myMapping;
+}
+
+TableCache::TableCache(int theCapacity, bool theUseDirectIO)
+        : myCapacity(max(theCapacity, 1)), myUseDirectIO(theUseDirectIO), myNumOpens(0) {}
+
+shared_ptr<OpenFile> TableCache::acquire(const string &thePath) {
+    lock_guard<mutex> lock(myMutex);
+    auto it = myEntries.find(thePath);
+    if (it != myEntries.end()) {
+        myLRU.splice(myLRU.begin(), myLRU, it->second.lruPosition);
+        return it->second.file;
+    }
+
+    bool isDirect;
+    int fd = openFile(thePath, O_RDONLY, myUseDirectIO, isDirect);
+    if (fd < 0) {
+        return nullptr;
+    }
+    myNumOpens++;
+
+    // close the least recently used file, unless a reader still holds it
+    if ((int) myEntries.size() >= myCapacity) {
+        myEntries.erase(myLRU.back());
+        myLRU.pop_back();
+    }
+
+    myLRU.push_front(thePath);
+    shared_ptr<OpenFile> file = make_shared<OpenFile>(fd, isDirect);
+    myEntries[thePath] = {file, myLRU.begin()};
+    return file;
+}
+
+void TableCache::evict(const string &thePath) {
+    lock_guard<mutex> lock(myMutex);
+    auto it = myEntries.find(thePath);
+    if (it == myEntries.end()) {
+        return;
+    }
+    myLRU.erase(it->second.lruPosition);
+    myEntries.erase(it);
+}
+
+void TableCache::clear() {
+    lock_guard<mutex> lock(myMutex);
+    myLRU.clear();
+    myEntries.clear();
+}
+
+int TableCache::size() {
+    lock_guard<mutex> lock(myMutex);
+    return myEntries.size();
+}
+
+uint64_t TableCache::getNumOpens() {
+    lock_guard<mutex> lock(myMutex);
+    return myNumOpens;
+}
@@ -0,0 +1,391 @@
+//
+// A write-ahead log making the memtable writes durable
+//
+
+#include "WriteAheadLog.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <utility>
+
+#include "xxHash32.h"
+
+namespace fs = std::filesystem;
+
+string WAL_FILENAME = "wal-";
+
+// key, value and checksum
+const size_t WAL_RECORD_SIZE = 3 * sizeof(int);
+
+// the pending records are written once they reach this size, unless the
+// sync mode writes them sooner
+const size_t WAL_BUFFER_SIZE = 64 * 1024;
+
+const uint32_t WAL_CHECKSUM_SEED = 0;
+
+// below this many records the log is replayed by a single thread
+const size_t WAL_PARALLEL_RECOVERY_RECORDS = 64 * 1024;
+
+WriteAheadLog::WriteAheadLog(string theDbName, WALSyncMode theSyncMode,
+                             int theSyncIntervalMs)
+        : myDbName(std::move(theDbName)), mySyncMode(theSyncMode),
+          mySyncIntervalMs(max(1, theSyncIntervalMs)), myFd(-1),
+          mySegmentId(0), mySegmentRecords(0), myAppendedSeq(0),
+          myWrittenSeq(0), myDurableSeq(0), myIsWriting(false),
+          myHasFailed(false), myIsStopping(false) {
+    // find the segments left by the previous run
+    for (const auto &entry: fs::directory_iterator(myDbName)) {
+        string fileName = entry.path().filename().string();
+        if (fileName.rfind(WAL_FILENAME, 0) == 0) {
+            myRecoveredSegments.push_back(
+                    stoull(fileName.substr(WAL_FILENAME.size())));
+        }
+    }
+    sort(myRecoveredSegments.begin(), myRecoveredSegments.end());
+
+    uint64_t firstSegmentId = 1;
+    if (!myRecoveredSegments.empty()) {
+        firstSegmentId = myRecoveredSegments.back() + 1;
+    }
+    openSegment(firstSegmentId);
+
+    if (mySyncMode == WALSyncMode::PERIODIC) {
+        mySyncThread = thread(&WriteAheadLog::syncPeriodically, this);
+    }
+}
+
+WriteAheadLog::~WriteAheadLog() {
+    if (myFd >= 0 || mySyncThread.joinable()) {
+        // keep the segment even if empty, the store was not closed
+        sync();
+        {
+            lock_guard<mutex> lock(myMutex);
+            myIsStopping = true;
+        }
+        myCondition.notify_all();
+        if (mySyncThread.joinable()) {
+            mySyncThread.join();
+        }
+        if (myFd >= 0) {
+            ::close(myFd);
+        }
+    }
+}
+
+string WriteAheadLog::segmentPath(uint64_t theSegmentId) {
+    return myDbName + "/" + WAL_FILENAME + to_string(theSegmentId);
+}
+
+bool WriteAheadLog::openSegment(uint64_t theSegmentId) {
+    mySegmentId = theSegmentId;
+    mySegmentRecords = 0;
+    myFd = open(segmentPath(theSegmentId).c_str(), O_WRONLY | O_CREAT | O_TRUNC,
+                0777);
+    if (myFd < 0) {
+        cerr << "Error opening write-ahead log: " << strerror(errno) << endl;
+        myHasFailed = true;
+        return false;
+    }
+    return true;
+}
+
+uint64_t WriteAheadLog::append(int theKey, int theValue) {
+    int record[3] = {theKey, theValue, 0};
+    uint32_t checksum = XXHash32::hash(record, 2 * sizeof(int), WAL_CHECKSUM_SEED);
+    memcpy(&record[2], &checksum, sizeof(checksum));
+
+    unique_lock<mutex> lock(myMutex);
+    const char *bytes = reinterpret_cast<const char *>(record);
+    myPending.insert(myPending.end(), bytes, bytes + WAL_RECORD_SIZE);
+    mySegmentRecords++;
+    uint64_t seq = ++myAppendedSeq;
+
+    // the durable mode writes on commit, the others write in large chunks
+    if (mySyncMode != WALSyncMode::ALWAYS && !myIsWriting &&
+        myPending.size() >= WAL_BUFFER_SIZE) {
+        writePending(lock, false);
+    }
+    return seq;
+}
+
+uint64_t WriteAheadLog::append(const array<int, 2> *theKVPairs, size_t theCount) {
+    vector<char> records(theCount * WAL_RECORD_SIZE);
+    for (size_t i = 0; i < theCount; i++) {
+        int record[3] = {theKVPairs[i][0], theKVPairs[i][1], 0};
+        uint32_t checksum = XXHash32::hash(record, 2 * sizeof(int), WAL_CHECKSUM_SEED);
+        memcpy(&record[2], &checksum, sizeof(checksum));
+        memcpy(&records[i * WAL_RECORD_SIZE], record, WAL_RECORD_SIZE);
+    }
+
+    unique_lock<mutex> lock(myMutex);
+    myPending.insert(myPending.end(), records.begin(), records.end());
+    mySegmentRecords += theCount;
+    myAppendedSeq += theCount;
+    uint64_t seq = myAppendedSeq;
+
+    if (mySyncMode != WALSyncMode::ALWAYS && !myIsWriting &&
+        myPending.size() >= WAL_BUFFER_SIZE) {
+        writePending(lock, false);
+    }
+    return seq;
+}
+
+void WriteAheadLog::writePending(unique_lock<mutex> &theLock,
+                                 bool theIsSyncing) {
+    myCondition.wait(theLock, [this] { return !myIsWriting; });
+
+    uint64_t targetSeq = myAppendedSeq;
+    if (targetSeq == myDurableSeq ||
+        (!theIsSyncing && targetSeq == myWrittenSeq)) {
+        return;
+    }
+
+    // take the whole group, the appends go on into a fresh buffer meanwhile
+    vector<char> records;
+    records.swap(myPending);
+    myIsWriting = true;
+    theLock.unlock();
+
+    bool isWritten = true;
+    size_t offset = 0;
+    while (isWritten && offset < records.size()) {
+        ssize_t bytesWritten =
+                write(myFd, records.data() + offset, records.size() - offset);
+        if (bytesWritten < 0 && errno != EINTR) {
+            isWritten = false;
+        } else if (bytesWritten > 0) {
+            offset += bytesWritten;
+        }
+    }
+    if (isWritten && theIsSyncing) {
+        isWritten = fdatasync(myFd) == 0;
+    }
+
+    theLock.lock();
+    myIsWriting = false;
+    if (!isWritten) {
+        cerr << "Error writing write-ahead log: " << strerror(errno) << endl;
+        myHasFailed = true;
+    }
+    myWrittenSeq = targetSeq;
+    if (theIsSyncing) {
+        myDurableSeq = targetSeq;
+    }
+
+    // hand the buffer back so its capacity is reused
+    if (myPending.empty()) {
+        records.clear();
+        myPending.swap(records);
+    }
+    myCondition.notify_all();
+}
+
+bool WriteAheadLog::commit(uint64_t theSeq) {
+    unique_lock<mutex> lock(myMutex);
+    if (mySyncMode != WALSyncMode::ALWAYS) {
+        return !myHasFailed;
+    }
+
+    // the first waiter syncs for everyone appended so far, and the others
+    // wait for it, so concurrent puts share one fdatasync
+    while (myDurableSeq < theSeq) {
+        if (myIsWriting) {
+            myCondition.wait(lock);
+        } else {
+            writePending(lock, true);
+        }
+    }
+    return !myHasFailed;
+}
+
+bool WriteAheadLog::sync() {
+    unique_lock<mutex> lock(myMutex);
+    uint64_t targetSeq = myAppendedSeq;
+    while (myDurableSeq < targetSeq) {
+        writePending(lock, true);
+    }
+    return !myHasFailed;
+}
+
+void WriteAheadLog::syncPeriodically() {
+    unique_lock<mutex> lock(myMutex);
+    while (!myIsStopping) {
+        myCondition.wait_for(lock, chrono::milliseconds(mySyncIntervalMs),
+                             [this] { return myIsStopping; });
+        if (myDurableSeq < myAppendedSeq) {
+            writePending(lock, true);
+        }
+    }
+}
+
+bool WriteAheadLog::roll() {
+    unique_lock<mutex> lock(myMutex);
+
+    // the segment must hold all of its records before it is closed
+    writePending(lock, mySyncMode != WALSyncMode::NONE);
+    myCondition.wait(lock, [this] { return !myIsWriting; });
+
+    if (myFd >= 0) {
+        ::close(myFd);
+    }
+    myClosedSegments.push_back(mySegmentId);
+    return openSegment(mySegmentId + 1);
+}
+
+void WriteAheadLog::releaseOldestSegment() {
+    lock_guard<mutex> lock(myMutex);
+    if (myClosedSegments.empty()) {
+        return;
+    }
+
+    uint64_t segmentId = myClosedSegments.front();
+    myClosedSegments.pop_front();
+    unlink(segmentPath(segmentId).c_str());
+}
+
+vector<array<int, 2>> WriteAheadLog::recover(size_t &theNumBytes) {
+    // a mapped segment and the position of its records in the result
+    struct MappedSegment {
+        const char *data;
+        size_t size;
+        size_t firstRecord;
+        size_t numRecords;
+        atomic<size_t> numValidRecords;
+    };
+
+    vector<MappedSegment> segments(myRecoveredSegments.size());
+    size_t numRecords = 0;
+    theNumBytes = 0;
+    for (size_t i = 0; i < myRecoveredSegments.size(); i++) {
+        MappedSegment &segment = segments[i];
+        segment.data = nullptr;
+        segment.size = 0;
+
+        int fd = open(segmentPath(myRecoveredSegments[i]).c_str(), O_RDONLY);
+        struct stat info;
+        if (fd >= 0 && fstat(fd, &info) == 0 && info.st_size > 0) {
+            void *data = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (data != MAP_FAILED) {
+                madvise(data, info.st_size, MADV_SEQUENTIAL);
+                madvise(data, info.st_size, MADV_WILLNEED);
+                segment.data = static_cast<const char *>(data);
+                segment.size = info.st_size;
+            }
+        }
+        if (fd >= 0) {
+            ::close(fd);
+        }
+
+        segment.firstRecord = numRecords;
+        segment.numRecords = segment.size / WAL_RECORD_SIZE;
+        segment.numValidRecords = segment.numRecords;
+        numRecords += segment.numRecords;
+        theNumBytes += segment.size;
+    }
+
+    // every thread validates and copies a contiguous range of records,
+    // remembering the first torn record of each segment
+    vector<array<int, 2>> kvPairs(numRecords);
+    auto replayRange = [&](size_t begin, size_t end) {
+        size_t segmentIdx = 0;
+        for (size_t record = begin; record < end; record++) {
+            while (record >= segments[segmentIdx].firstRecord +
+                             segments[segmentIdx].numRecords) {
+                segmentIdx++;
+            }
+            MappedSegment &segment = segments[segmentIdx];
+            size_t recordInSegment = record - segment.firstRecord;
+
+            int fields[3];
+            memcpy(fields, segment.data + recordInSegment * WAL_RECORD_SIZE,
+                   WAL_RECORD_SIZE);
+            uint32_t checksum;
+            memcpy(&checksum, &fields[2], sizeof(checksum));
+            if (checksum !=
+                XXHash32::hash(fields, 2 * sizeof(int), WAL_CHECKSUM_SEED)) {
+                size_t numValid = segment.numValidRecords.load();
+                while (recordInSegment < numValid &&
+                       !segment.numValidRecords.compare_exchange_weak(
+                               numValid, recordInSegment)) {
+                }
+                continue;
+            }
+            kvPairs[record] = {fields[0], fields[1]};
+        }
+    };
+
+    size_t numThreads = 1;
+    if (numRecords >= WAL_PARALLEL_RECOVERY_RECORDS) {
+        numThreads = max(1u, thread::hardware_concurrency());
+    }
+    size_t recordsPerThread = (numRecords + numThreads - 1) / numThreads;
+    vector<thread> threads;
+    for (size_t i = 1; i < numThreads; i++) {
+        size_t begin = min(numRecords, i * recordsPerThread);
+        size_t end = min(numRecords, begin + recordsPerThread);
+        threads.emplace_back(replayRange, begin, end);
+    }
+    replayRange(0, min(numRecords, recordsPerThread));
+    for (thread &worker: threads) {
+        worker.join();
+    }
+
+    // a torn write ends its segment, nothing after it was acknowledged
+    size_t numKept = 0;
+    for (MappedSegment &segment: segments) {
+        size_t numValid = segment.numValidRecords.load();
+        if (numKept != segment.firstRecord) {
+            move(kvPairs.begin() + segment.firstRecord,
+                 kvPairs.begin() + segment.firstRecord + numValid,
+                 kvPairs.begin() + numKept);
+        }
+        numKept += numValid;
+
+        if (segment.data != nullptr) {
+            munmap(const_cast<char *>(segment.data), segment.size);
+        }
+    }
+    kvPairs.resize(numKept);
+
+    return kvPairs;
+}
+
+void WriteAheadLog::removeRecoveredSegments() {
+    for (uint64_t segmentId: myRecoveredSegments) {
+        unlink(segmentPath(segmentId).c_str());
+    }
+    myRecoveredSegments.clear();
+}
+
+bool WriteAheadLog::close() {
+    bool isSynced = sync();
+
+    {
+        lock_guard<mutex> lock(myMutex);
+        myIsStopping = true;
+    }
+    myCondition.notify_all();
+    if (mySyncThread.joinable()) {
+        mySyncThread.join();
+    }
+
+    if (myFd >= 0) {
+        ::close(myFd);
+        myFd = -1;
+
+        // a closed store leaves no log behind when every memtable is saved
+        if (mySegmentRecords == 0) {
+            unlink(segmentPath(mySegmentId).c_str());
+        }
+    }
+    return isSynced;
+}
@@ -14,7 +14,8 @@ using namespace std::chrono;
 
 // Function to measure throughput of B-tree get operation
 void run_btree_get_experiment(int totalKVPairs, int intervals, int queries,
-                              const string& filename) {
+                              const string& filename,
+                              bool useMmapReads = false) {
     int intervalSize = static_cast<int>(totalKVPairs / intervals);
 
     // Open the CSV file to save results
@@ -31,7 +32,7 @@ void run_btree_get_experiment(int totalKVPairs, int intervals, int queries,
     int memSize = (1 << 20) / 8 * 1;  // 1MB total
     int bufferCapacity =
         (1 << 20) / 4096 * 10;  // ~10MB total, ignoring metadata
-    KVStore kvStore(memSize, "testDB", bufferCapacity);
+    KVStore kvStore(memSize, "testDB", bufferCapacity, useMmapReads);
 
     int prev_size = 0;
     for (int size = intervalSize; size <= totalKVPairs;
@@ -100,5 +101,9 @@ int main() {
     run_btree_get_experiment(totalKVPairs, intervals, queries,
                              "btree_get_throughput.csv");
 
+    // the same lookups reading the mapped SSTs and B-trees
+    run_btree_get_experiment(totalKVPairs, intervals, queries,
+                             "btree_get_throughput_mmap.csv", true);
+
     return 0;
 }
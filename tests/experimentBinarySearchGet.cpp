@@ -14,7 +14,7 @@ using namespace std::chrono;
 
 // Function to measure throughput and run the experiment
 void run_experiment(int totalKVPairs, int intervals, int queries,
-                    const string& filename) {
+                    const string& filename, bool useMmapReads = false) {
     int intervalSize = static_cast<int>(totalKVPairs / intervals);
 
     // Open the CSV file to save results
@@ -32,7 +32,7 @@ void run_experiment(int totalKVPairs, int intervals, int queries,
     int bufferCapacity =
         (1 << 20) / 4096 * 10;  // ~10mb total, ignoring metadata
     shared_ptr<KVStore> kvStore =
-        make_shared<KVStore>(memSize, "testDB", bufferCapacity);
+        make_shared<KVStore>(memSize, "testDB", bufferCapacity, useMmapReads);
 
     int prev_size = 0;
     for (int size = intervalSize; size <= totalKVPairs;
@@ -94,5 +94,9 @@ int main() {
 
     run_experiment(totalKVPairs, intervals, queries, "bin_search_get_throughput.csv");
 
+    // the same lookups binary searching the mapped SSTs
+    run_experiment(totalKVPairs, intervals, queries,
+                   "bin_search_get_throughput_mmap.csv", true);
+
     return 0;
 }
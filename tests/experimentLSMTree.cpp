@@ -14,7 +14,7 @@ using namespace std::chrono;
 
 // Function to measure throughput and run the experiment
 void run_experiment(int totalKVPairs, int intervals, int queries,
-                    const string& filename) {
+                    const string& filename, LSMOptions options = LSMOptions()) {
     int intervalSize = static_cast<int>(totalKVPairs / intervals);
 
     // Open the CSV file to save results
@@ -25,14 +25,14 @@ void run_experiment(int totalKVPairs, int intervals, int queries,
     }
 
     // Write the header of the CSV file
-    output_file << "Data Size (GB),Throughput (KB/s),Time Taken (s)\n";
+    output_file << "Data Size (GB),Throughput (KB/s),Time Taken (s),Hit Rate\n";
 
     // init data
     int memSize = (1 << 20) / 8 * 1;  // 1mb total
     int bufferCapacity =
         (1 << 20) / 4096 * 10;  // ~10mb total, ignoring metadata
     shared_ptr<LSMStore> lsmStore =
-        make_shared<LSMStore>(memSize, "testDB", bufferCapacity);
+        make_shared<LSMStore>(memSize, "testDB", bufferCapacity, options);
 
     int prev_size = 0;
     for (int size = intervalSize; size <= totalKVPairs;
@@ -47,6 +47,7 @@ void run_experiment(int totalKVPairs, int intervals, int queries,
         prev_size = size;
 
         cout << "Querying pages" << endl;
+        lsmStore->resetBufferPoolStats();
         auto start_time = high_resolution_clock::now();
 
         // create a random number generator for the key selection
@@ -75,11 +76,15 @@ void run_experiment(int totalKVPairs, int intervals, int queries,
             static_cast<double>(queries * KVPAIR_SIZE / (1 << 10)) /
             duration_seconds;
 
+        // the hit rate of the buffer pool over the queries only
+        double hitRate = lsmStore->getBufferPoolStats().hitRate();
+
         // output to csv
         output_file << dataSizeGB << "," << throughput << ","
-                    << duration_seconds << "\n";
+                    << duration_seconds << "," << hitRate << "\n";
         cout << std::setprecision(4) << "Throughput: " << throughput
-             << " KB/s | Time Taken: " << duration_seconds << " s\n";
+             << " KB/s | Time Taken: " << duration_seconds
+             << " s | Hit Rate: " << hitRate * 100 << "%\n";
     }
 
     lsmStore->deleteDb();
@@ -94,5 +99,11 @@ int main() {
 
     run_experiment(totalKVPairs, intervals, queries, "query_throughput.csv");
 
+    // the same lookups reading the mapped SSTs instead of the buffer pool
+    LSMOptions mmapOptions;
+    mmapOptions.useMmapReads = true;
+    run_experiment(totalKVPairs, intervals, queries, "query_throughput_mmap.csv",
+                   mmapOptions);
+
     return 0;
 }
@@ -1,13 +1,21 @@
+#include <fcntl.h>
 #include <sys/stat.h>
+#include <unistd.h>
 
+#include <atomic>
 #include <cassert>
+#include <filesystem>
 #include <iostream>
+#include <thread>
 
 #include "../include/AVLTree.h"
 #include "../include/KVStore.h"
 #include "../include/SSTController.h"
+#include "../include/SSTWriter.h"
+#include "../include/SkipList.h"
 #include "../include/xxHash32.h"
 #include "LSMController.h"
+#include "LSMStore.h"
 
 int readIntFromPath(const string &expectedMetaDataPath);
 
@@ -100,6 +108,10 @@ array<int, 2> runAVLTreeTests() {
     int intResult = tree.getValue(25);
     checkTestResult<int>(123, intResult, passed, failed);
 
+    cout << "Test: TryGet" << endl;
+    checkTestResult<int>(123, tree.tryGet(25).value_or(-1), passed, failed);
+    checkTestResult<bool>(false, tree.tryGet(26).has_value(), passed, failed);
+
     cout << "Test: Insertion limit" << endl;
     bool boolResult = tree.insert(60, 60);
     checkTestResult<bool>(false, boolResult, passed, failed);
@@ -116,6 +128,103 @@ array<int, 2> runAVLTreeTests() {
     checkTestResult(expected, stringifyKvPairs(tree.scan(20, 70)), passed,
                     failed);
 
+    cout << "Test: Iterator Seek" << endl;
+    unique_ptr<KVIterator> iterator = tree.newIterator();
+    string seekResult;
+    for (iterator->seek(26); iterator->valid(); iterator->next()) {
+        seekResult += to_string(iterator->key()) + " ";
+    }
+    checkTestResult<string>("30 40 50 60 70 ", seekResult, passed, failed);
+
+    cout << "Test: Clear" << endl;
+    tree.clear();
+    checkTestResult<string>("", tree.inOrderString(), passed, failed);
+    tree.insert(5, 5);
+    tree.insert(3, 3);
+    tree.insert(4, 4);
+    checkTestResult<string>("4 3 5 ", tree.preOrderString(), passed, failed);
+
+    cout << "Test: Bulk Load" << endl;
+    tree.clear();
+    vector<array<int, 2>> sortedPairs = {{1, 1}, {2, 2}, {3, 3}, {4, 4},
+                                         {5, 5}, {6, 6}, {7, 7}};
+    tree.bulkLoad(sortedPairs.data(), sortedPairs.size());
+    checkTestResult<string>("4 2 1 3 6 5 7 ", tree.preOrderString(), passed,
+                            failed);
+
+    // Summary of tests completed
+    cout << "Tests completed: " << passed << "/" << (passed + failed)
+         << " passed." << endl;
+
+    array<int, 2> passFail = {passed, failed};
+    return passFail;
+}
+
+array<int, 2> runSkipListTests() {
+    cout << "\n" << endl;
+    cout << "#################################" << endl;
+    cout << "# Running [Skip list tests]..." << endl;
+    cout << "#################################" << endl;
+
+    // Setup
+    int passed = 0;
+    int failed = 0;
+    SkipList list(8);
+
+    cout << "Test: Multiple insertions" << endl;
+    list.insert(30, 30);
+    list.insert(10, 10);
+    list.insert(50, 50);
+    list.insert(20, 20);
+    list.insert(40, 40);
+    list.insert(25, 123);
+    string expected = "(10,10) (20,20) (25,123) (30,30) (40,40) (50,50) ";
+    checkTestResult(expected, stringifyKvPairs(list.scan()), passed, failed);
+
+    cout << "Test: Get" << endl;
+    checkTestResult<int>(123, list.getValue(25), passed, failed);
+
+    cout << "Test: Insertion limit" << endl;
+    checkTestResult<bool>(false, list.insert(60, 60), passed, failed);
+    checkTestResult<bool>(true, list.insert(70, 60), passed, failed);
+
+    cout << "Test: Scan Inclusive" << endl;
+    expected = "(20,20) (25,123) (30,30) (40,40) (50,50) (60,60) (70,60) ";
+    checkTestResult(expected, stringifyKvPairs(list.scan(20, 70)), passed,
+                    failed);
+
+    cout << "Test: Concurrent insertions" << endl;
+    int numThreads = 4;
+    int keysPerThread = 10000;
+    SkipList concurrentList(numThreads * keysPerThread);
+    vector<thread> threads;
+    for (int t = 0; t < numThreads; t++) {
+        threads.emplace_back([&concurrentList, t, numThreads, keysPerThread]() {
+            // interleave the keys of the threads
+            for (int i = 0; i < keysPerThread; i++) {
+                int key = i * numThreads + t;
+                concurrentList.insert(key, key * 2);
+            }
+        });
+    }
+    for (auto &t: threads) {
+        t.join();
+    }
+    const vector<array<int, 2>> &allPairs = concurrentList.scan();
+    bool isComplete = (int) allPairs.size() == numThreads * keysPerThread;
+    for (int i = 0; isComplete && i < (int) allPairs.size(); i++) {
+        isComplete = allPairs[i][0] == i && allPairs[i][1] == i * 2;
+    }
+    checkTestResult<bool>(true, isComplete, passed, failed);
+
+    cout << "Test: Bulk Load" << endl;
+    list.clear();
+    vector<array<int, 2>> sortedPairs = {{1, 1}, {2, 2}, {3, 3}, {4, 4}};
+    list.bulkLoad(sortedPairs.data(), sortedPairs.size());
+    list.insert(0, 0);
+    expected = "(0,0) (1,1) (2,2) (3,3) (4,4) ";
+    checkTestResult(expected, stringifyKvPairs(list.scan()), passed, failed);
+
     // Summary of tests completed
     cout << "Tests completed: " << passed << "/" << (passed + failed)
          << " passed." << endl;
@@ -212,6 +321,11 @@ array<int, 2> runSSTControllerTests() {
     assert(false == pair2.first);
     checkTestResult<int>(-1, pair2.second, passed, failed);
 
+    cout << "Test: SST TryGet" << endl;
+    checkTestResult<int>(15, controller.tryGet(10).value_or(-1), passed, failed);
+    checkTestResult<bool>(false, controller.tryGet(100).has_value(), passed,
+                          failed);
+
     cout << "Test: SST Scan" << endl;
     const vector<array<int, 2>> &scanResult = controller.scan(19, 67);
     expectedKvPairs =
@@ -231,7 +345,8 @@ array<int, 2> runSSTControllerTests() {
 
 int readIntFromPath(const string &expectedMetaDataPath) {
     ifstream inputFile(expectedMetaDataPath);
-    int result;
+    // an empty metadata file holds no SSTs
+    int result = 0;
     inputFile >> result;
     inputFile.close();
     return result;
@@ -255,6 +370,363 @@ array<int, 2> runBufferPoolTests() {
     int actual = XXHash32::hash(input2.c_str(), input2.size(), seed);
     checkTestResult<int>(expected, actual, passed, failed);
 
+    cout << "Test: Put and get pages" << endl;
+    BufferPool bufferPool(2);
+    vector<array<int, 2>> page1 = {{1, 10}};
+    vector<array<int, 2>> page2 = {{2, 20}};
+    vector<array<int, 2>> page3 = {{3, 30}};
+    bufferPool.putPage(BufferPool::makeLeveledPageId(1, 1, 1), page1);
+    bufferPool.putPage(BufferPool::makeLeveledPageId(2, 1, 1), page2);
+    string pages;
+    for (int level = 1; level <= 2; level++) {
+        PageHandle page = bufferPool.getPage(BufferPool::makeLeveledPageId(level, 1, 1));
+        pages += stringifyKvPairs(vector<array<int, 2>>(page.begin(), page.end()));
+    }
+    checkTestResult<string>("(1,10) (2,20) ", pages, passed, failed);
+
+    cout << "Test: Clock eviction" << endl;
+    bufferPool.putPage(BufferPool::makeLeveledPageId(3, 1, 1), page3);
+    bool isEvicted = bufferPool.getPage(BufferPool::makeLeveledPageId(1, 1, 1)).empty();
+    checkTestResult<bool>(true, isEvicted, passed, failed);
+
+    cout << "Test: Eviction skips pinned pages" << endl;
+    BufferPool singleFramePool(1);
+    PageHandle pinned = singleFramePool.putPage(BufferPool::makePageId(1, 1), page1);
+    PageHandle uncached = singleFramePool.putPage(BufferPool::makePageId(1, 2), page2);
+    bool isPinnedKept = !singleFramePool.getPage(BufferPool::makePageId(1, 1)).empty() &&
+                        singleFramePool.getPage(BufferPool::makePageId(1, 2)).empty() &&
+                        uncached[0][1] == 20;
+    pinned.release();
+    singleFramePool.putPage(BufferPool::makePageId(1, 3), page3);
+    bool isUnpinnedEvicted = singleFramePool.getPage(BufferPool::makePageId(1, 1)).empty();
+    checkTestResult<bool>(true, isPinnedKept && isUnpinnedEvicted, passed, failed);
+
+    cout << "Test: Page table after many evictions" << endl;
+    BufferPool largerPool(64);
+    int numCached = 0;
+    for (int page = 0; page < 1000; page++) {
+        vector<array<int, 2>> kvPairs = {{page, page}};
+        largerPool.putPage(BufferPool::makePageId(page % 7, page), kvPairs);
+    }
+    for (int page = 0; page < 1000; page++) {
+        PageHandle kvPairs = largerPool.getPage(BufferPool::makePageId(page % 7, page));
+        if (!kvPairs.empty() && kvPairs[0][0] == page) {
+            numCached++;
+        }
+    }
+    checkTestResult<int>(64, numCached, passed, failed);
+
+    cout << "Test: Sharded pool shared by reader threads" << endl;
+    BufferPoolOptions shardedOptions;
+    shardedOptions.numShards = 4;
+    BufferPool shardedPool(256, shardedOptions);
+    vector<thread> readers;
+    vector<int> numWrongPages(4, 0);
+    for (int t = 0; t < 4; t++) {
+        readers.emplace_back([&shardedPool, &numWrongPages, t]() {
+            for (int i = 0; i < 5000; i++) {
+                int page = (i * 7 + t) % 512;
+                PageId pageId = BufferPool::makePageId(1, page);
+                PageHandle kvPairs = shardedPool.getPage(pageId);
+                if (kvPairs.empty()) {
+                    vector<array<int, 2>> pageKVPairs = {{page, page}};
+                    kvPairs = shardedPool.putPage(pageId, pageKVPairs);
+                }
+                if (kvPairs.size() != 1 || kvPairs[0][0] != page) {
+                    numWrongPages[t]++;
+                }
+            }
+        });
+    }
+    for (thread &reader : readers) {
+        reader.join();
+    }
+    uint64_t numLookups = 0;
+    for (BufferPoolStats stats : shardedPool.getShardStats()) {
+        numLookups += stats.hits + stats.misses;
+    }
+    checkTestResult<int>(0, numWrongPages[0] + numWrongPages[1] + numWrongPages[2] +
+                                numWrongPages[3], passed, failed);
+    checkTestResult<int>(4, shardedPool.getNumShards(), passed, failed);
+    checkTestResult<uint64_t>(20000, numLookups, passed, failed);
+
+    cout << "Test: Invalidate the pages of one SST" << endl;
+    BufferPool sstPool(4);
+    vector<array<int, 2>> sstPage = {{1, 1}};
+    sstPool.putPage(BufferPool::makeLeveledPageId(1, 1, 1), sstPage);
+    sstPool.putPage(BufferPool::makeLeveledPageId(1, 1, 2), sstPage);
+    sstPool.putPage(BufferPool::makeLeveledPageId(2, 1, 1), sstPage);
+    PageHandle pinnedPage = sstPool.getPage(BufferPool::makeLeveledPageId(1, 1, 1));
+    int numDropped = sstPool.invalidateSST(1, 1);
+    bool isInvalidated =
+        numDropped == 2 && pinnedPage.size() == 1 &&
+        sstPool.getPage(BufferPool::makeLeveledPageId(1, 1, 1)).empty() &&
+        sstPool.getPage(BufferPool::makeLeveledPageId(1, 1, 2)).empty() &&
+        !sstPool.getPage(BufferPool::makeLeveledPageId(2, 1, 1)).empty();
+    checkTestResult<bool>(true, isInvalidated, passed, failed);
+
+    cout << "Test: Invalidated frames are reused" << endl;
+    pinnedPage.release();
+    for (int page = 0; page < 3; page++) {
+        sstPool.putPage(BufferPool::makeLeveledPageId(3, 1, page), sstPage);
+    }
+    // the two freed frames and the last unused one take the new pages, so
+    // the untouched level is not evicted
+    checkTestResult<bool>(false, sstPool.getPage(BufferPool::makeLeveledPageId(2, 1, 1)).empty(),
+                          passed, failed);
+
+    cout << "Test: 2Q keeps hot pages through a scan" << endl;
+    BufferPoolOptions twoQueueOptions;
+    twoQueueOptions.evictionPolicy = EvictionPolicyType::TWO_QUEUE;
+    BufferPool twoQueuePool(8, twoQueueOptions);
+    vector<array<int, 2>> scanPage = {{2, 2}};
+    twoQueuePool.putPage(BufferPool::makePageId(1, 0), scanPage);
+    twoQueuePool.putPage(BufferPool::makePageId(1, 1), scanPage);
+    for (int page = 0; page < 8; page++) {
+        twoQueuePool.putPage(BufferPool::makePageId(2, page), scanPage);
+    }
+    // the hot pages are read again after leaving the queue of new pages
+    twoQueuePool.putPage(BufferPool::makePageId(1, 0), scanPage);
+    twoQueuePool.putPage(BufferPool::makePageId(1, 1), scanPage);
+    for (int page = 0; page < 100; page++) {
+        twoQueuePool.putPage(BufferPool::makePageId(4, page), scanPage);
+    }
+    bool isHotCached = !twoQueuePool.getPage(BufferPool::makePageId(1, 0)).empty() &&
+                       !twoQueuePool.getPage(BufferPool::makePageId(1, 1)).empty();
+    checkTestResult<bool>(true, isHotCached, passed, failed);
+
+    cout << "Test: Pages hinted not to be cached" << endl;
+    PageHandle uncachedPage =
+        twoQueuePool.putPage(BufferPool::makePageId(5, 0), scanPage, CacheHint::DONT_CACHE);
+    checkTestResult<bool>(true,
+                          uncachedPage.size() == 1 &&
+                              twoQueuePool.getPage(BufferPool::makePageId(5, 0)).empty(),
+                          passed, failed);
+
+    cout << "Test: TinyLFU keeps frequent pages" << endl;
+    BufferPoolOptions tinyLFUOptions;
+    tinyLFUOptions.admissionPolicy = AdmissionPolicyType::TINY_LFU;
+    // a sketch much wider than the pages read keeps the estimates exact
+    tinyLFUOptions.admissionSketchWidth = 4096;
+    BufferPool tinyLFUPool(4, tinyLFUOptions);
+    // each page is looked up before it is put, as on the read path
+    auto readPage = [&tinyLFUPool, &scanPage](PageId pageId) {
+        PageHandle kvPairs = tinyLFUPool.getPage(pageId);
+        if (kvPairs.empty()) {
+            kvPairs = tinyLFUPool.putPage(pageId, scanPage);
+        }
+        return !kvPairs.empty();
+    };
+    for (int round = 0; round < 3; round++) {
+        for (int page = 0; page < 4; page++) {
+            readPage(BufferPool::makePageId(1, page));
+        }
+    }
+    bool isEveryPageRead = true;
+    for (int page = 0; page < 100; page++) {
+        isEveryPageRead = readPage(BufferPool::makePageId(2, page)) && isEveryPageRead;
+    }
+    int numHotCached = 0;
+    for (int page = 0; page < 4; page++) {
+        numHotCached += tinyLFUPool.findPage(1, page) != -1;
+    }
+    checkTestResult<bool>(true, isEveryPageRead, passed, failed);
+    checkTestResult<int>(4, numHotCached, passed, failed);
+
+    cout << "Test: Buffer pool statistics" << endl;
+    BufferPool statsPool(2);
+    statsPool.getPage(BufferPool::makeLeveledPageId(1, 1, 1));
+    statsPool.putPage(BufferPool::makeLeveledPageId(1, 1, 1), scanPage);
+    statsPool.getPage(BufferPool::makeLeveledPageId(1, 1, 1));
+    statsPool.getPage(BufferPool::makeLeveledPageId(2, 1, 1));
+    for (int page = 2; page <= 4; page++) {
+        statsPool.putPage(BufferPool::makeLeveledPageId(2, 1, page), scanPage);
+    }
+    BufferPoolStats poolStats = statsPool.getStats();
+    vector<SSTCacheStats> sstStats = statsPool.getSSTStats();
+    bool isCounted = poolStats.hits == 1 && poolStats.misses == 2 && poolStats.evictions == 2 &&
+                     poolStats.averageProbeLength() > 0 && sstStats.size() == 2 &&
+                     sstStats[0].level == 1 && sstStats[0].hits == 1 &&
+                     sstStats[0].misses == 1 && sstStats[1].level == 2 &&
+                     sstStats[1].misses == 1;
+    checkTestResult<bool>(true, isCounted, passed, failed);
+    checkTestResult<double>(1.0 / 3, poolStats.hitRate(), passed, failed);
+    statsPool.resetStats();
+    checkTestResult<uint64_t>(0, statsPool.getStats().misses + statsPool.getSSTStats().size(),
+                              passed, failed);
+
+    cout << "Test: Shrink and grow the pool" << endl;
+    BufferPool resizedPool(8);
+    for (int page = 0; page < 8; page++) {
+        vector<array<int, 2>> kvPairs = {{page, page}};
+        resizedPool.putPage(BufferPool::makePageId(1, page), kvPairs);
+    }
+    PageHandle retiredPage = resizedPool.getPage(BufferPool::makePageId(1, 7));
+    resizedPool.resize(2);
+    int numCachedAfterShrink = 0;
+    for (int page = 0; page < 8; page++) {
+        numCachedAfterShrink += resizedPool.findPage(1, page) != -1;
+    }
+    bool isShrunk = resizedPool.getCapacity() == 2 && numCachedAfterShrink == 2 &&
+                    retiredPage.size() == 1 && retiredPage[0][0] == 7;
+    checkTestResult<bool>(true, isShrunk, passed, failed);
+    retiredPage.release();
+    resizedPool.resize(16);
+    for (int page = 0; page < 16; page++) {
+        vector<array<int, 2>> kvPairs = {{page, page}};
+        resizedPool.putPage(BufferPool::makePageId(2, page), kvPairs);
+    }
+    int numCachedAfterGrow = 0;
+    for (int page = 0; page < 16; page++) {
+        PageHandle kvPairs = resizedPool.getPage(BufferPool::makePageId(2, page));
+        numCachedAfterGrow += !kvPairs.empty() && kvPairs[0][0] == page;
+    }
+    checkTestResult<int>(16, numCachedAfterGrow, passed, failed);
+
+    cout << "Test: Resize while readers run" << endl;
+    BufferPoolOptions resizeOptions;
+    resizeOptions.numShards = 2;
+    BufferPool onlinePool(64, resizeOptions);
+    atomic<bool> isResizing(true);
+    atomic<int> numWrongReads(0);
+    vector<thread> onlineReaders;
+    for (int t = 0; t < 2; t++) {
+        onlineReaders.emplace_back([&onlinePool, &isResizing, &numWrongReads, t]() {
+            for (int i = 0; isResizing; i++) {
+                int page = (i * 13 + t) % 256;
+                PageId pageId = BufferPool::makePageId(3, page);
+                PageHandle kvPairs = onlinePool.getPage(pageId);
+                if (kvPairs.empty()) {
+                    vector<array<int, 2>> pageKVPairs = {{page, page}};
+                    kvPairs = onlinePool.putPage(pageId, pageKVPairs);
+                }
+                if (kvPairs.size() != 1 || kvPairs[0][0] != page) {
+                    numWrongReads++;
+                }
+            }
+        });
+    }
+    for (int round = 0; round < 50; round++) {
+        onlinePool.resize(round % 2 == 0 ? 4 : 128);
+    }
+    isResizing = false;
+    for (thread &reader : onlineReaders) {
+        reader.join();
+    }
+    checkTestResult<int>(0, numWrongReads, passed, failed);
+
+    cout << "Test: Page table splits and merges buckets" << endl;
+    PageTable pageTable;
+    for (int page = 0; page < 10000; page++) {
+        pageTable.insert(BufferPool::makePageId(page % 5, page), page);
+    }
+    int grownDepth = pageTable.getGlobalDepth();
+    bool isMapped = true;
+    for (int page = 0; page < 10000; page++) {
+        isMapped = isMapped && pageTable.find(BufferPool::makePageId(page % 5, page)) == page;
+    }
+    // keep every tenth page, so merged buckets hold pages to move
+    for (int page = 0; page < 10000; page++) {
+        if (page % 10 != 0) {
+            pageTable.erase(BufferPool::makePageId(page % 5, page));
+        }
+    }
+    for (int page = 0; page < 10000; page++) {
+        int expectedFrame = page % 10 == 0 ? page : -1;
+        isMapped = isMapped && pageTable.find(BufferPool::makePageId(page % 5, page)) == expectedFrame;
+    }
+    checkTestResult<bool>(true, isMapped, passed, failed);
+    checkTestResult<bool>(true, grownDepth >= 11 && pageTable.getGlobalDepth() < grownDepth,
+                          passed, failed);
+
+    cout << "Test: Data pages do not evict index pages" << endl;
+    BufferPoolOptions tieredOptions;
+    tieredOptions.numShards = 1;
+    tieredOptions.highPriorityRatio = 0.25;
+    BufferPool tieredPool(8, tieredOptions);
+    vector<array<int, 2>> nodePage = {{1, -1}, {2, -2}};
+    tieredPool.putPage(BufferPool::makeIndexPageId(1, 0), KVSpan(nodePage), CacheHint::NORMAL,
+                       PagePriority::HIGH);
+    tieredPool.putPage(BufferPool::makeIndexPageId(1, 1), KVSpan(nodePage), CacheHint::NORMAL,
+                       PagePriority::HIGH);
+    for (int page = 0; page < 100; page++) {
+        tieredPool.putPage(BufferPool::makePageId(1, page), KVSpan(nodePage));
+    }
+    bool isIndexCached = !tieredPool.getPage(BufferPool::makeIndexPageId(1, 0)).empty() &&
+                         !tieredPool.getPage(BufferPool::makeIndexPageId(1, 1)).empty();
+    checkTestResult<bool>(true, isIndexCached, passed, failed);
+    // a third index page is past the high-priority region, so it replaces an
+    // index page rather than a data page
+    tieredPool.putPage(BufferPool::makeIndexPageId(1, 2), KVSpan(nodePage), CacheHint::NORMAL,
+                       PagePriority::HIGH);
+    int numIndexPages = 0;
+    for (int node = 0; node < 3; node++) {
+        numIndexPages += !tieredPool.getPage(BufferPool::makeIndexPageId(1, node)).empty();
+    }
+    int numDataPages = 0;
+    for (int page = 0; page < 100; page++) {
+        numDataPages += tieredPool.findPage(1, page) != -1;
+    }
+    checkTestResult<int>(2, numIndexPages, passed, failed);
+    checkTestResult<int>(6, numDataPages, passed, failed);
+    checkTestResult<int>(2, tieredPool.invalidateIndex(1), passed, failed);
+
+    cout << "Test: Frames in one region with or without huge pages" << endl;
+    bool isHugePoolCorrect = true;
+    for (bool useHugePages : {true, false}) {
+        BufferPoolOptions hugePageOptions;
+        hugePageOptions.useHugePages = useHugePages;
+        BufferPool hugePagePool(1024, hugePageOptions);
+        // the frames are backed by huge pages as a whole, or not at all when
+        // the system has none
+        int numHugePageFrames = hugePagePool.getNumHugePageFrames();
+        isHugePoolCorrect = isHugePoolCorrect && (useHugePages ? numHugePageFrames % 1024 == 0
+                                                              : numHugePageFrames == 0);
+        hugePagePool.resize(2048);
+        for (int page = 0; page < 2048; page++) {
+            vector<array<int, 2>> kvPairs = {{page, page}};
+            hugePagePool.putPage(BufferPool::makePageId(1, page), KVSpan(kvPairs));
+        }
+        // the shards fill unevenly, so only the pages still cached are read
+        int numCached = 0;
+        for (int page = 0; page < 2048; page++) {
+            PageHandle cached = hugePagePool.getPage(BufferPool::makePageId(1, page));
+            numCached += !cached.empty();
+            isHugePoolCorrect = isHugePoolCorrect && (cached.empty() || cached[0][1] == page);
+        }
+        isHugePoolCorrect = isHugePoolCorrect && numCached > 1024;
+    }
+    checkTestResult<bool>(true, isHugePoolCorrect, passed, failed);
+
+    cout << "Test: Pages read straight into frames" << endl;
+    BufferPool loadingPool(1);
+    auto readPageOf = [](int theKey, int theNumKVPairs) {
+        return [theKey, theNumKVPairs](char *buffer) -> ssize_t {
+            auto *kvPairs = reinterpret_cast<array<int, 2> *>(buffer);
+            for (int i = 0; i < theNumKVPairs; i++) {
+                kvPairs[i] = {theKey, i};
+            }
+            return theNumKVPairs * KVPAIR_SIZE;
+        };
+    };
+    bool isLoadCorrect;
+    {
+        PageHandle loaded = loadingPool.loadPage(BufferPool::makePageId(1, 0), readPageOf(1, B));
+        // the only frame is pinned, so the next page is handed out uncached
+        PageHandle uncached = loadingPool.loadPage(BufferPool::makePageId(1, 1), readPageOf(2, 3));
+        isLoadCorrect = loaded.size() == B && loaded.back()[1] == B - 1 &&
+                        uncached.size() == 3 && uncached[0][0] == 2 &&
+                        loadingPool.getPage(BufferPool::makePageId(1, 1)).empty();
+    }
+    isLoadCorrect = isLoadCorrect && loadingPool.getPage(BufferPool::makePageId(1, 0))[0][0] == 1;
+    // a page past the end of the file gives back its frame
+    isLoadCorrect = isLoadCorrect &&
+                    loadingPool.loadPage(BufferPool::makePageId(1, 2), readPageOf(3, 0)).empty();
+    isLoadCorrect = isLoadCorrect &&
+                    loadingPool.loadPage(BufferPool::makePageId(1, 3), readPageOf(4, 1)).size() == 1 &&
+                    loadingPool.getPage(BufferPool::makePageId(1, 3))[0][0] == 4;
+    checkTestResult<bool>(true, isLoadCorrect, passed, failed);
+
     return {passed, failed};
 }
 
@@ -309,6 +781,28 @@ array<int, 2> runBTreeTests() {
 
     kvStore.deleteDb();
 
+    cout << "Test: B-tree and binary search gets in memory-mapped mode" << endl;
+    KVStore mmapStore = KVStore(memSize, "testMmapDB", bufferCapacity, true);
+    for (int i = 0; i < totalKVPairs * 2; i++) {
+        mmapStore.put(i, i * 2);
+    }
+    // the second SST overwrites some keys of the first one
+    for (int i = 0; i < totalKVPairs; i++) {
+        mmapStore.put(i * 2, i);
+    }
+    mmapStore.createStaticBTree();
+    bool isMmapGetCorrect = true;
+    for (int key : {1, 10, 511, totalKVPairs - 1, totalKVPairs, totalKVPairs * 2 - 1}) {
+        // the even keys were overwritten by the later puts
+        int value = key % 2 == 0 && key < totalKVPairs * 2 ? key / 2 : key * 2;
+        isMmapGetCorrect = isMmapGetCorrect && mmapStore.bTreeGet(key) == value &&
+                           mmapStore.get(key) == value;
+    }
+    isMmapGetCorrect = isMmapGetCorrect && !mmapStore.bTreeTryGet(totalKVPairs * 2).has_value() &&
+                       !mmapStore.tryGet(totalKVPairs * 2).has_value();
+    checkTestResult<bool>(true, isMmapGetCorrect, passed, failed);
+    mmapStore.deleteDb();
+
     return {passed, failed};
 }
 
@@ -412,6 +906,367 @@ array<int, 2> runLSMControllerTests() {
     // Clean up test data
     controller.deleteFiles();
 
+    cout << "Test: Compaction of Multi-page SSTs" << endl;
+    LSMController multiPageController("MyLSMMultiPageDatabase",
+                                      bufferPoolCapacity);
+    // the SSTs overlap on the odd keys and span several pages each
+    vector<array<int, 2>> olderPairs;
+    vector<array<int, 2>> newerPairs;
+    for (int i = 0; i < 3 * B; i++) {
+        olderPairs.push_back({i * 2 + 1, 1});
+        newerPairs.push_back({i, 2});
+    }
+    multiPageController.save(olderPairs, 1);
+    multiPageController.save(newerPairs, 1);
+    const vector<array<int, 2>> &compacted =
+        multiPageController.scan(0, 6 * B);
+    bool isMerged = compacted.size() == 4.5 * B;
+    for (int i = 0; isMerged && i < (int) compacted.size(); i++) {
+        int expectedValue = compacted[i][0] < 3 * B ? 2 : 1;
+        isMerged = compacted[i][1] == expectedValue;
+    }
+    checkTestResult<bool>(true, isMerged, passed, failed);
+    multiPageController.deleteFiles();
+
+    cout << "Test: Compaction Output Cached" << endl;
+    LSMOptions cachingOptions;
+    cachingOptions.cacheCompactionOutput = true;
+    LSMController cachingController("MyLSMCachingDatabase", 16, cachingOptions);
+    cachingController.save(olderPairs, 1);
+    cachingController.save(newerPairs, 1);
+    cachingController.save(olderPairs, 1);
+    cachingController.save(newerPairs, 1);
+    // the second compaction rewrites level 2, whose stale pages must be gone
+    const vector<array<int, 2>> &cachedCompacted =
+        cachingController.scan(0, 6 * B);
+    checkTestResult<bool>(true, cachedCompacted == compacted, passed, failed);
+    cachingController.deleteFiles();
+
+    cout << "Test: Direct I/O" << endl;
+    LSMOptions directOptions;
+    directOptions.useDirectIO = true;
+    LSMController directController("MyLSMDirectDatabase", 16, directOptions);
+    directController.save(olderPairs, 1);
+    directController.save(newerPairs, 1);
+    const vector<array<int, 2>> &directCompacted = directController.scan(0, 6 * B);
+    checkTestResult<bool>(true, directCompacted == compacted, passed, failed);
+    checkTestResult<int>(1, directController.get(3 * B + 1).second, passed, failed);
+    // the padding of the half-full last page is truncated away
+    checkTestResult<int>(4.5 * B * KVPAIR_SIZE,
+                         (int) filesystem::file_size("MyLSMDirectDatabase/level-2/sst-1"),
+                         passed, failed);
+    directController.deleteFiles();
+
+    cout << "Test: Batched I/O backends" << endl;
+    bool isBatchCorrect = true;
+    for (IOBackendType backendType : {IOBackendType::IO_URING, IOBackendType::THREAD_POOL}) {
+        // a queue depth below the batch size issues the batch in turns
+        unique_ptr<IOBackend> backend = IOBackend::create(backendType, 3);
+        int fd = open("io-backend-test", O_RDWR | O_CREAT | O_TRUNC, 0644);
+        vector<vector<int>> pages(8, vector<int>(B * 2));
+        vector<IORequest> writes;
+        for (int page = 0; page < 8; page++) {
+            fill(pages[page].begin(), pages[page].end(), page);
+            writes.push_back({IORequest::WRITE, fd, reinterpret_cast<char *>(pages[page].data()),
+                              PAGE_SIZE, (off_t) page * PAGE_SIZE, 0});
+        }
+        backend->submitAndWait(writes);
+
+        vector<vector<int>> readBack(9, vector<int>(B * 2, -1));
+        vector<IORequest> reads;
+        for (int page = 0; page < 9; page++) {
+            reads.push_back({IORequest::READ, fd, reinterpret_cast<char *>(readBack[page].data()),
+                             PAGE_SIZE, (off_t) page * PAGE_SIZE, 0});
+        }
+        backend->submitAndWait(reads);
+        for (int page = 0; page < 8; page++) {
+            isBatchCorrect = isBatchCorrect && writes[page].result == PAGE_SIZE &&
+                             reads[page].result == PAGE_SIZE && readBack[page] == pages[page];
+        }
+        // past the end of the file
+        isBatchCorrect = isBatchCorrect && reads[8].result == 0;
+        close(fd);
+        remove("io-backend-test");
+    }
+    checkTestResult<bool>(true, isBatchCorrect, passed, failed);
+
+    cout << "Test: Streaming SST writer" << endl;
+    {
+        // a buffer of 2 pages is written out twice before the last 1.5 pages
+        int fd = open("sst-writer-test", O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        SSTWriter writer(fd, false, 2 * PAGE_SIZE);
+        writer.preallocate(8 * B);
+        vector<array<int, 2>> written;
+        for (int pageNum = 0; pageNum < 6; pageNum++) {
+            array<int, 2> *page = writer.nextPage();
+            int numKVPairs = pageNum < 5 ? B : B / 2;
+            for (int i = 0; i < numKVPairs; i++) {
+                page[i] = {(int) written.size(), pageNum};
+                written.push_back(page[i]);
+            }
+            writer.addPage(numKVPairs);
+        }
+        bool isWritten = writer.finish();
+        close(fd);
+
+        // the preallocated blocks past the KV-pairs are not part of the file
+        vector<array<int, 2>> readBack(written.size() + 1);
+        fd = open("sst-writer-test", O_RDONLY);
+        ssize_t numBytes = read(fd, readBack.data(), readBack.size() * KVPAIR_SIZE);
+        close(fd);
+        readBack.resize(max((ssize_t) 0, numBytes) / KVPAIR_SIZE);
+        checkTestResult<bool>(true, isWritten && readBack == written, passed, failed);
+        remove("sst-writer-test");
+    }
+
+    cout << "Test: Compaction and Scan Through the Thread Pool" << endl;
+    LSMOptions threadPoolOptions;
+    threadPoolOptions.ioBackend = IOBackendType::THREAD_POOL;
+    threadPoolOptions.ioQueueDepth = 2;
+    LSMController threadPoolController("MyLSMThreadPoolDatabase", 16, threadPoolOptions);
+    threadPoolController.save(olderPairs, 1);
+    threadPoolController.save(newerPairs, 1);
+    checkTestResult<bool>(true, threadPoolController.scan(0, 6 * B) == compacted, passed, failed);
+    threadPoolController.deleteFiles();
+
+    cout << "Test: Memory-mapped reads" << endl;
+    LSMOptions mmapOptions;
+    mmapOptions.useMmapReads = true;
+    LSMController mmapController("MyLSMMmapDatabase", 16, mmapOptions);
+    mmapController.save(olderPairs, 1);
+    mmapController.save(newerPairs, 1);
+    checkTestResult<bool>(true, mmapController.scan(0, 6 * B) == compacted, passed, failed);
+    // the rewritten level 2 is mapped anew
+    mmapController.save(olderPairs, 1);
+    mmapController.save(newerPairs, 1);
+    checkTestResult<bool>(true, mmapController.scan(0, 6 * B) == compacted, passed, failed);
+    checkTestResult<int>(1, mmapController.get(3 * B + 1).second, passed, failed);
+    checkTestResult<bool>(false, mmapController.get(6 * B + 1).first, passed, failed);
+    // nothing is read through the buffer pool
+    checkTestResult<int>(0, (int) mmapController.getBufferPoolStats().misses, passed, failed);
+    mmapController.deleteFiles();
+
+    cout << "Test: Readahead window grows with sequential reads" << endl;
+    Readahead readahead(16);
+    // the first page starts the stream, then each window doubles once the
+    // reader is halfway through the previous one
+    ReadaheadRange first = readahead.onRead(1, 1, 1);
+    ReadaheadRange quiet = readahead.onRead(1, 1, 2);
+    readahead.onRead(1, 1, 3);
+    ReadaheadRange second = readahead.onRead(1, 1, 4);
+    for (int page = 5; page < 10; page++) {
+        readahead.onRead(1, 1, page);
+    }
+    ReadaheadRange third = readahead.onRead(1, 1, 10);
+    checkTestResult<bool>(true, first.firstPage == 2 && first.numPages == 4, passed, failed);
+    checkTestResult<int>(0, quiet.numPages, passed, failed);
+    checkTestResult<bool>(true, second.firstPage == 6 && second.numPages == 8, passed, failed);
+    checkTestResult<bool>(true, third.firstPage == 14 && third.numPages == 16, passed, failed);
+    // a jump falls back to the smallest window, and other SSTs are unaffected
+    ReadaheadRange jump = readahead.onRead(1, 1, 50);
+    ReadaheadRange other = readahead.onRead(2, 1, 1);
+    ReadaheadRange resumed = readahead.onRead(1, 1, 51);
+    checkTestResult<int>(0, jump.numPages, passed, failed);
+    checkTestResult<int>(4, other.numPages, passed, failed);
+    checkTestResult<bool>(true, resumed.firstPage == 52 && resumed.numPages == 8, passed, failed);
+    Readahead disabled(0);
+    checkTestResult<int>(0, disabled.onRead(1, 1, 1).numPages, passed, failed);
+
+    cout << "Test: Table cache keeps a bounded number of files open" << endl;
+    for (int fileIdx = 0; fileIdx < 3; fileIdx++) {
+        ofstream("table-cache-" + to_string(fileIdx)) << fileIdx;
+    }
+    TableCache tableCache(2);
+    shared_ptr<OpenFile> firstFile = tableCache.acquire("table-cache-0");
+    bool isSameFile = tableCache.acquire("table-cache-0") == firstFile;
+    tableCache.acquire("table-cache-1");
+    tableCache.acquire("table-cache-2");
+    checkTestResult<bool>(true, isSameFile, passed, failed);
+    checkTestResult<int>(2, tableCache.size(), passed, failed);
+    checkTestResult<int>(3, (int) tableCache.getNumOpens(), passed, failed);
+    // the evicted file stays readable by its holder, and a file rewritten
+    // after its eviction is read anew
+    char firstByte = 0;
+    checkTestResult<int>(1, (int) pread(firstFile->fd(), &firstByte, 1, 0), passed, failed);
+    tableCache.evict("table-cache-2");
+    remove("table-cache-2");
+    ofstream("table-cache-2") << 7;
+    char rewrittenByte = 0;
+    pread(tableCache.acquire("table-cache-2")->fd(), &rewrittenByte, 1, 0);
+    checkTestResult<char>('7', rewrittenByte, passed, failed);
+    checkTestResult<bool>(true, tableCache.acquire("missing-file") == nullptr, passed, failed);
+    for (int fileIdx = 0; fileIdx < 3; fileIdx++) {
+        remove(("table-cache-" + to_string(fileIdx)).c_str());
+    }
+
+    // Summary of tests completed
+    cout << "Tests completed: " << passed << "/" << (passed + failed)
+         << " passed." << endl;
+    array<int, 2> passFail = {passed, failed};
+    return passFail;
+}
+
+array<int, 2> runLSMStoreTests() {
+    cout << "#################################" << endl;
+    cout << "# Running LSM-Tree Store tests..." << endl;
+    cout << "#################################" << endl;
+
+    // Setup
+    int passed = 0;
+    int failed = 0;
+    int memtableSize = 4;
+    int bufferPoolCapacity = 1;
+    const string dbName = "MyLSMStoreDatabase";
+    LSMOptions options;
+    options.walSyncMode = WALSyncMode::ALWAYS;
+
+    cout << "Test: Write-Ahead Log Replay" << endl;
+    {
+        // the store is dropped without close, as in a crash, leaving the
+        // last memtable only in the log
+        LSMStore store(memtableSize, dbName, bufferPoolCapacity, options);
+        for (int i = 1; i <= 6; i++) {
+            store.put(i, i * 10);
+        }
+        store.remove(2);
+    }
+    LSMStore store(memtableSize, dbName, bufferPoolCapacity, options);
+    string expectedKvPairs = "(1,10) (3,30) (4,40) (5,50) (6,60) ";
+    checkTestResult<string>(expectedKvPairs,
+                            stringifyKvPairs(store.scan(1, 10)), passed,
+                            failed);
+
+    cout << "Test: Close Truncates the Log" << endl;
+    store.close();
+    bool hasLog = false;
+    for (const auto &entry: filesystem::directory_iterator(dbName)) {
+        hasLog = hasLog || entry.path().filename().string().rfind("wal-", 0) == 0;
+    }
+    checkTestResult<bool>(false, hasLog, passed, failed);
+    store.deleteDb();
+
+    cout << "Test: Concurrent puts of a key are logged in order" << endl;
+    {
+        const string skipListDbName = "MyLSMStoreSkipListDatabase";
+        LSMOptions skipListOptions;
+        skipListOptions.memtableType = MemtableType::SKIP_LIST;
+        skipListOptions.walSyncMode = WALSyncMode::NONE;
+        // writers racing on a few keys, so some puts of a key interleave
+        const int numKeys = 16;
+        vector<int> valuesBeforeCrash(numKeys);
+        {
+            LSMStore skipListStore(1024, skipListDbName, bufferPoolCapacity, skipListOptions);
+            vector<thread> writers;
+            for (int writer = 0; writer < 8; writer++) {
+                writers.emplace_back([&skipListStore, writer] {
+                    for (int i = 0; i < 4000; i++) {
+                        skipListStore.put(i % numKeys, writer * 4000 + i);
+                    }
+                });
+            }
+            for (thread &writer: writers) {
+                writer.join();
+            }
+            for (int key = 0; key < numKeys; key++) {
+                valuesBeforeCrash[key] = skipListStore.get(key);
+            }
+        }
+        // the replay keeps the last logged value, which must be the one read
+        LSMStore recoveredStore(1024, skipListDbName, bufferPoolCapacity, skipListOptions);
+        bool isRecoveredInOrder = true;
+        for (int key = 0; key < numKeys; key++) {
+            isRecoveredInOrder = isRecoveredInOrder && recoveredStore.get(key) == valuesBeforeCrash[key];
+        }
+        checkTestResult<bool>(true, isRecoveredInOrder, passed, failed);
+        recoveredStore.deleteDb();
+    }
+
+    cout << "Test: Failed Flush Is Retried" << endl;
+    {
+        const string failingDbName = "MyLSMStoreFailingDatabase";
+        LSMStore failingStore(memtableSize, failingDbName, bufferPoolCapacity, options);
+        // a file in place of the directory of the first level fails the
+        // saves of the memtables
+        ofstream(failingDbName + "/level-1").close();
+        for (int i = 1; i <= 2 * memtableSize; i++) {
+            failingStore.put(i, i * 10);
+        }
+        this_thread::sleep_for(chrono::milliseconds(50));
+        bool isKeptReadable = failingStore.tryGet(1).value_or(-1) == 10 &&
+                              failingStore.tryGet(memtableSize).value_or(-1) == memtableSize * 10;
+
+        // once the directory can be created, the retry saves the memtables
+        filesystem::remove(failingDbName + "/level-1");
+        bool isClosed = failingStore.close();
+        LSMStore reopenedStore(memtableSize, failingDbName, bufferPoolCapacity, options);
+        checkTestResult<bool>(true,
+                              isKeptReadable && isClosed &&
+                                  (int) reopenedStore.scan(1, 2 * memtableSize).size() == 2 * memtableSize,
+                              passed, failed);
+        reopenedStore.deleteDb();
+    }
+
+    cout << "Test: Queued Memtables Are Readable Before Their Flush" << endl;
+    {
+        const string queuedDbName = "MyLSMStoreQueuedDatabase";
+        LSMStore queuedStore(memtableSize, queuedDbName, bufferPoolCapacity, options);
+        // the failing saves keep the full memtables in the queue
+        ofstream(queuedDbName + "/level-1").close();
+        int numKeys = 2 * memtableSize + 1;
+        for (int i = 1; i <= numKeys; i++) {
+            queuedStore.put(i, i * 10);
+        }
+        // a newer value of a queued key shadows the older one
+        queuedStore.put(1, 11);
+
+        bool isEveryKeyFound = true;
+        for (int i = 2; i <= numKeys; i++) {
+            isEveryKeyFound = isEveryKeyFound && queuedStore.tryGet(i).value_or(-1) == i * 10;
+        }
+        vector<array<int, 2>> scanned = queuedStore.scan(1, numKeys);
+        checkTestResult<bool>(true,
+                              isEveryKeyFound && queuedStore.tryGet(1).value_or(-1) == 11 &&
+                                  (int) scanned.size() == numKeys && scanned[0][1] == 11,
+                              passed, failed);
+
+        filesystem::remove(queuedDbName + "/level-1");
+        queuedStore.close();
+        queuedStore.deleteDb();
+    }
+
+    cout << "Test: Writers Stall At The Immutable Memtable Limit" << endl;
+    {
+        const string stalledDbName = "MyLSMStoreStalledDatabase";
+        LSMOptions stallingOptions = options;
+        stallingOptions.maxImmutableMemtables = 1;
+        LSMStore stalledStore(memtableSize, stalledDbName, bufferPoolCapacity, stallingOptions);
+        ofstream(stalledDbName + "/level-1").close();
+
+        // the second full memtable finds the queue full, so its last put
+        // waits for the flush of the first one
+        int numKeys = 2 * memtableSize;
+        atomic<int> numPuts(0);
+        thread writer([&] {
+            for (int i = 1; i <= numKeys; i++) {
+                stalledStore.put(i, i * 10);
+                numPuts++;
+            }
+        });
+        this_thread::sleep_for(chrono::milliseconds(100));
+        bool isStalled = numPuts.load() == numKeys - 1;
+
+        // once the saves succeed, the flush drains the queue and the writer
+        // resumes
+        filesystem::remove(stalledDbName + "/level-1");
+        writer.join();
+        checkTestResult<bool>(true,
+                              isStalled && numPuts.load() == numKeys &&
+                                  (int) stalledStore.scan(1, numKeys).size() == numKeys,
+                              passed, failed);
+        stalledStore.close();
+        stalledStore.deleteDb();
+    }
+
     // Summary of tests completed
     cout << "Tests completed: " << passed << "/" << (passed + failed)
          << " passed." << endl;
@@ -423,10 +1278,12 @@ int main() {
     vector<array<int, 2>> passFails;
 
     passFails.push_back(runAVLTreeTests());
+    passFails.push_back(runSkipListTests());
     passFails.push_back(runSSTControllerTests());
     passFails.push_back(runBufferPoolTests());
     passFails.push_back(runBTreeTests());
     passFails.push_back(runLSMControllerTests());
+    passFails.push_back(runLSMStoreTests());
 
     // calculate the total number of passed/failed tests
     int passed = 0;